@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+"""Benchmark harness for the leader election on RIOT native.
+
+Starts N instances of the application, each attached to its own TAP
+interface, and records state changes and periodic statistics printed by
+bench builds (`make BENCH=1`). Reports the time until a single stable
+coordinator is elected, optionally the recovery time after the coordinator
+is killed, messages sent per node and interval, and poll round latency.
+
+Example:
+    make -C src clean all BENCH=1 LOG_LEVEL=LOG_INFO NODES_NUM=8
+    sudo RIOT/dist/tools/tapsetup/tapsetup -c 8
+    bench/elect_bench.py -n 8 --kill-leader -o report.json
+"""
+
+import argparse
+import json
+import os
+import re
+import signal
+import subprocess
+import sys
+import threading
+import time
+
+STATE_RE = re.compile(r"state: (\w+)")
+STATS_RE = re.compile(r"stats: (.*)")
+# stack use per thread as `name=used/size`, printed by DEVELHELP builds
+STACK_RE = re.compile(r"stack: (.*)")
+# counters of all messages sent by the application, responses other than
+# sensor values are counted with their request, as by the simulator
+TX_COUNTERS = ("bcast_tx", "poll_tx", "sensor_tx", "aggr_tx", "standby_tx",
+               "sync_tx", "nodes_tx", "reg_tx", "announce_tx")
+# election interval as defined in src/elect.h, e.g. `(2U * MS_PER_SEC)`
+INTERVAL_RE = re.compile(
+    r"#define\s+ELECT_MSG_INTERVAL\s+\((\d+)U?(\s*\*\s*MS_PER_SEC)?\)")
+ELECT_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..",
+                       "src", "elect.h")
+
+
+class Node:
+    """A running instance and everything it printed."""
+
+    def __init__(self, index, elf, tap, events, lock):
+        self.index = index
+        self.tap = tap
+        self.stats = None
+        # intervals elapsed, each as long as the interval in effect
+        self.intervals = 0.0
+        self.stacks = {}
+        self.started = time.monotonic()
+        self.proc = subprocess.Popen(
+            ["stdbuf", "-oL", elf, tap], stdout=subprocess.PIPE,
+            stderr=subprocess.STDOUT, universal_newlines=True)
+        self._events = events
+        self._lock = lock
+        self._reader = threading.Thread(target=self._read, daemon=True)
+        self._reader.start()
+
+    def _read(self):
+        for line in self.proc.stdout:
+            now = time.monotonic()
+            m = STATE_RE.search(line)
+            if m:
+                with self._lock:
+                    self._events.append((now, self.index, m.group(1)))
+                continue
+            m = STATS_RE.search(line)
+            if m:
+                stats = dict((k, int(v)) for k, v in
+                             (kv.split("=") for kv in m.group(1).split()))
+                last = self.stats["time"] if self.stats else 0
+                if stats.get("interval"):
+                    self.intervals += (stats["time"] - last) / stats["interval"]
+                self.stats = stats
+                continue
+            m = STACK_RE.search(line)
+            if m:
+                for kv in m.group(1).split():
+                    name, used = kv.rsplit("=", 1)
+                    self.stacks[name] = int(used.split("/")[0])
+
+    def alive(self):
+        return self.proc.poll() is None
+
+    def stop(self):
+        if self.alive():
+            self.proc.send_signal(signal.SIGINT)
+            try:
+                self.proc.wait(timeout=2)
+            except subprocess.TimeoutExpired:
+                self.proc.kill()
+
+
+def converged(states, alive):
+    """Return index of the coordinator if all alive nodes agree on one."""
+    leaders = [i for i in alive if states.get(i) == "COORDINATOR"]
+    if len(leaders) != 1:
+        return None
+    if any(states.get(i) != "CLIENT" for i in alive if i != leaders[0]):
+        return None
+    return leaders[0]
+
+
+def wait_stable(nodes, events, lock, since, settle, timeout):
+    """Wait until a single coordinator is stable for `settle` seconds.
+
+    All events are replayed, so nodes that keep their state are known.
+    Returns (time of convergence relative to `since`, coordinator index),
+    or (None, None) on timeout.
+    """
+    states = {}
+    seen = 0
+    stable_at = None
+    leader = None
+    while time.monotonic() - since < timeout:
+        with lock:
+            new = events[seen:]
+            seen = len(events)
+        for ev_time, index, state in new:
+            states[index] = state
+            alive = [n.index for n in nodes if n.alive()]
+            current = converged(states, alive)
+            if current is None:
+                stable_at, leader = None, None
+            elif current != leader:
+                stable_at, leader = max(ev_time, since), current
+        # nodes may have been killed since the last event
+        if leader is not None and converged(
+                states, [n.index for n in nodes if n.alive()]) != leader:
+            stable_at, leader = None, None
+        if stable_at is not None and time.monotonic() - stable_at >= settle:
+            return stable_at - since, leader
+        time.sleep(0.05)
+    return None, None
+
+
+def summarize(nodes, interval):
+    """Messages per node and interval, poll round latency, and high-water
+    marks of stacks and main's queue.
+
+    Intervals are those in effect on each node as it reported them, the
+    nominal `interval` is only used for nodes that did not.
+    """
+    per_node = []
+    rounds = {"count": 0, "sum_us": 0, "max_us": 0}
+    stack_max = {}
+    queue_max = None
+    for node in nodes:
+        for name, used in node.stacks.items():
+            stack_max[name] = max(stack_max.get(name, 0), used)
+        stats = node.stats
+        if not stats or stats.get("time", 0) == 0:
+            continue
+        intervals = node.intervals or stats["time"] / interval
+        per_node.append(sum(stats.get(c, 0) for c in TX_COUNTERS) / intervals)
+        rounds["count"] += stats.get("rounds", 0)
+        rounds["sum_us"] += stats.get("round_sum", 0)
+        rounds["max_us"] = max(rounds["max_us"], stats.get("round_max", 0))
+        if "queue_max" in stats:
+            queue_max = max(queue_max or 0, stats["queue_max"])
+    report = {
+        "msgs_per_node_interval": {
+            "mean": sum(per_node) / len(per_node) if per_node else None,
+            "max": max(per_node) if per_node else None,
+        },
+        "round_latency_us": {
+            "count": rounds["count"],
+            "mean": rounds["sum_us"] / rounds["count"] if rounds["count"] else None,
+            "max": rounds["max_us"],
+        },
+        "stack_max": stack_max,
+        "queue_max": queue_max,
+    }
+    return report
+
+
+def default_interval():
+    """ELECT_MSG_INTERVAL in ms as read from src/elect.h, 2000 if not found."""
+    try:
+        with open(ELECT_H) as header:
+            match = INTERVAL_RE.search(header.read())
+    except OSError:
+        match = None
+    if not match:
+        return 2000
+    return int(match.group(1)) * (1000 if match.group(2) else 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("-n", "--nodes", type=int, default=4,
+                        help="number of instances (default: %(default)s)")
+    parser.add_argument("--elf", default=os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), "..", "src", "bin",
+        "native", "vslab-riot.elf"), help="application binary")
+    parser.add_argument("--interval", type=int, default=default_interval(),
+                        help="ELECT_MSG_INTERVAL in ms (default: %(default)s)")
+    parser.add_argument("--settle", type=float, default=None,
+                        help="seconds a result must be stable (default: 3 intervals)")
+    parser.add_argument("--timeout", type=float, default=60,
+                        help="seconds to wait for convergence (default: %(default)s)")
+    parser.add_argument("--run", type=float, default=10,
+                        help="seconds to run after convergence (default: %(default)s)")
+    parser.add_argument("--kill-leader", action="store_true",
+                        help="kill the coordinator and measure recovery")
+    parser.add_argument("--setup-taps", metavar="TAPSETUP",
+                        help="path to RIOT's tapsetup, to create the interfaces")
+    parser.add_argument("-o", "--output", help="write JSON report to file")
+    args = parser.parse_args()
+    settle = args.settle if args.settle is not None else 3 * args.interval / 1000
+
+    if args.setup_taps:
+        subprocess.check_call([args.setup_taps, "-c", str(args.nodes)])
+
+    events = []
+    lock = threading.Lock()
+    start = time.monotonic()
+    nodes = [Node(i, args.elf, "tap%d" % i, events, lock)
+             for i in range(args.nodes)]
+    report = {"nodes": args.nodes, "interval_ms": args.interval}
+    try:
+        conv, leader = wait_stable(nodes, events, lock, start, settle,
+                                   args.timeout)
+        report["convergence_s"] = conv
+        report["coordinator"] = nodes[leader].tap if leader is not None else None
+        if leader is not None and args.kill_leader:
+            killed = time.monotonic()
+            nodes[leader].stop()
+            conv, leader = wait_stable(nodes, events, lock, killed, settle,
+                                       args.timeout)
+            report["recovery_s"] = conv
+            report["new_coordinator"] = (nodes[leader].tap
+                                         if leader is not None else None)
+        time.sleep(args.run)
+    finally:
+        for node in nodes:
+            node.stop()
+    report["state_changes"] = len(events)
+    report.update(summarize(nodes, args.interval))
+
+    out = json.dumps(report, indent=2)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(out + "\n")
+    print(out)
+    return 0 if report["convergence_s"] is not None else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""Footprint report of the leader election application.
+
+Reports ROM (text + data) and static RAM (data + bss) of each module of the
+application from its object files, and optionally the stack high-water marks
+of all threads and the queue high-water mark of main, as recorded by a bench
+run (`bench/elect_bench.py -o report.json` of a `make BENCH=1` build), and
+the deepest call chain of each application thread from the call graph gcc
+writes in a `make CALLGRAPH=1` build. With a baseline, growth beyond the
+tolerance fails the report.
+
+Example:
+    make -C src LEAN=1 CALLGRAPH=1 footprint
+    bench/footprint.py --size arm-none-eabi-size \\
+        --bench report.json --callgraph src/bin/pba-d-01-kw2x \\
+        --baseline footprint.json src/bin/pba-d-01-kw2x/vslab-riot
+"""
+
+import argparse
+import glob
+import json
+import os
+import re
+import subprocess
+import sys
+
+
+def modules(size, objdir):
+    """ROM and static RAM per object file in `objdir`."""
+    objs = sorted(glob.glob(os.path.join(objdir, "*.o")))
+    if not objs:
+        raise SystemExit("no object files in %s" % objdir)
+    out = subprocess.check_output([size] + objs, universal_newlines=True)
+    result = {}
+    # Berkeley format: text data bss dec hex filename
+    for line in out.splitlines()[1:]:
+        fields = line.split()
+        text, data, bss = (int(v) for v in fields[:3])
+        name = os.path.splitext(os.path.basename(fields[5]))[0]
+        result[name] = {"rom": text + data, "ram": data + bss}
+    return result
+
+
+def stacks(report):
+    """Stack and queue high-water marks from a bench report."""
+    with open(report) as f:
+        bench = json.load(f)
+    return bench.get("stack_max", {}), bench.get("queue_max")
+
+
+# entry function of each application thread, by thread name
+THREADS = {"listen": "_listen_loop", "aggr": "_aggr_loop",
+           "sensor": "_sample_loop"}
+# `node: { title: "file:func" label: "func\nfile:line:col\n48 bytes (static)" }`
+CI_NODE_RE = re.compile(r'node: \{ title: "([^"]+)" label: "([^"]*)"')
+CI_EDGE_RE = re.compile(
+    r'edge: \{ sourcename: "([^"]+)" targetname: "([^"]+)"')
+CI_BYTES_RE = re.compile(r"(\d+) bytes")
+
+
+def callgraph(bindir):
+    """Deepest stack use of each thread from the .ci files below `bindir`.
+
+    Functions without stack use, e.g. of modules built without
+    `-fcallgraph-info=su`, count as 0 bytes, and calls through function
+    pointers are not followed.
+    """
+    frames = {}
+    calls = {}
+    for path in glob.glob(os.path.join(bindir, "**", "*.ci"), recursive=True):
+        with open(path) as f:
+            for line in f:
+                m = CI_NODE_RE.match(line)
+                if m:
+                    used = CI_BYTES_RE.search(m.group(2))
+                    if used:
+                        frames[m.group(1)] = int(used.group(1))
+                    continue
+                m = CI_EDGE_RE.match(line)
+                if m:
+                    calls.setdefault(m.group(1), set()).add(m.group(2))
+    if not frames:
+        raise SystemExit("no call graph in %s, build with CALLGRAPH=1" % bindir)
+
+    depth = {}
+
+    def deepest(func, active):
+        if func in depth:
+            return depth[func]
+        if func in active:
+            # recursion, its depth is unbounded
+            return 0
+        active.add(func)
+        below = max((deepest(c, active) for c in calls.get(func, ())),
+                    default=0)
+        active.discard(func)
+        depth[func] = frames.get(func, 0) + below
+        return depth[func]
+
+    result = {}
+    for name, entry in THREADS.items():
+        for func in frames:
+            if func == entry or func.endswith(":" + entry):
+                result[name] = deepest(func, set())
+    return result
+
+
+def compare(current, baseline, tolerance):
+    """Return list of (module, kind, old, new) that grew beyond tolerance."""
+    grown = []
+    for name, sizes in sorted(current["modules"].items()):
+        old = baseline.get("modules", {}).get(name)
+        if old is None:
+            continue
+        for kind in ("rom", "ram"):
+            if sizes[kind] > old[kind] + tolerance:
+                grown.append((name, kind, old[kind], sizes[kind]))
+    for name, used in sorted(current.get("stack_max", {}).items()):
+        old = baseline.get("stack_max", {}).get(name)
+        if old is not None and used > old + tolerance:
+            grown.append((name, "stack", old, used))
+    for name, used in sorted(current.get("callgraph", {}).items()):
+        old = baseline.get("callgraph", {}).get(name)
+        if old is not None and used > old + tolerance:
+            grown.append((name, "call chain", old, used))
+    return grown
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("objdir", help="object files of the application")
+    parser.add_argument("--size", default="size",
+                        help="size tool of the toolchain (default: %(default)s)")
+    parser.add_argument("--bench", metavar="REPORT",
+                        help="JSON report of bench/elect_bench.py")
+    parser.add_argument("--callgraph", metavar="BINDIR",
+                        help="build directory of a CALLGRAPH=1 build")
+    parser.add_argument("--baseline", metavar="FOOTPRINT",
+                        help="JSON output of an earlier run to compare with")
+    parser.add_argument("--tolerance", type=int, default=0,
+                        help="bytes a value may grow (default: %(default)s)")
+    parser.add_argument("-o", "--output", help="write JSON report to file")
+    args = parser.parse_args()
+
+    report = {"modules": modules(args.size, args.objdir)}
+    report["total"] = {
+        kind: sum(m[kind] for m in report["modules"].values())
+        for kind in ("rom", "ram")
+    }
+    if args.bench:
+        report["stack_max"], report["queue_max"] = stacks(args.bench)
+    if args.callgraph:
+        report["callgraph"] = callgraph(args.callgraph)
+
+    print("%-12s %8s %8s" % ("module", "rom", "ram"))
+    for name, sizes in sorted(report["modules"].items()):
+        print("%-12s %8d %8d" % (name, sizes["rom"], sizes["ram"]))
+    print("%-12s %8d %8d" % ("total", report["total"]["rom"],
+                             report["total"]["ram"]))
+    if args.bench:
+        print("\n%-12s %8s" % ("thread", "stack"))
+        for name, used in sorted(report["stack_max"].items()):
+            print("%-12s %8s" % (name, used))
+        print("%-12s %8s" % ("main queue", report["queue_max"]))
+    if args.callgraph:
+        print("\n%-12s %8s" % ("thread", "chain"))
+        for name, used in sorted(report["callgraph"].items()):
+            print("%-12s %8d" % (name, used))
+
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(json.dumps(report, indent=2) + "\n")
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            grown = compare(report, json.load(f), args.tolerance)
+        for name, kind, old, new in grown:
+            print("%s: %s grew from %d to %d bytes" % (name, kind, old, new),
+                  file=sys.stderr)
+        return 1 if grown else 0
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       Host replacement of RIOT's kernel_types.h for the simulator
+ *
+ * @}
+ */
+
+#ifndef KERNEL_TYPES_H
+#define KERNEL_TYPES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int16_t kernel_pid_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KERNEL_TYPES_H */
+/** @} */
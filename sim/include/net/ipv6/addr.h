@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       Host replacement of RIOT's net/ipv6/addr.h for the simulator
+ *
+ * @}
+ */
+
+#ifndef NET_IPV6_ADDR_H
+#define NET_IPV6_ADDR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IPV6_ADDR_MAX_STR_LEN   (sizeof("ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff"))
+
+#define IPV6_ADDR_ALL_NODES_LINK_LOCAL  {{ 0xff, 0x02, 0x00, 0x00, \
+                                           0x00, 0x00, 0x00, 0x00, \
+                                           0x00, 0x00, 0x00, 0x00, \
+                                           0x00, 0x00, 0x00, 0x01 }}
+
+/**
+ * @brief IPv6 address, bytes in network byte order
+ */
+typedef union {
+    uint8_t u8[16];
+    uint32_t u32[4];
+    uint64_t u64[2];
+} ipv6_addr_t;
+
+static inline bool ipv6_addr_is_unspecified(const ipv6_addr_t *addr)
+{
+    return (addr->u64[0] == 0) && (addr->u64[1] == 0);
+}
+
+static inline void ipv6_addr_set_unspecified(ipv6_addr_t *addr)
+{
+    addr->u64[0] = 0;
+    addr->u64[1] = 0;
+}
+
+static inline bool ipv6_addr_is_link_local(const ipv6_addr_t *addr)
+{
+    return (addr->u8[0] == 0xfe) && ((addr->u8[1] & 0xc0) == 0x80);
+}
+
+static inline void ipv6_addr_set_link_local_prefix(ipv6_addr_t *addr)
+{
+    addr->u8[0] = 0xfe;
+    addr->u8[1] = 0x80;
+    for (unsigned i = 2; i < 8; ++i) {
+        addr->u8[i] = 0;
+    }
+}
+
+/**
+ * @brief Convert address to string, all groups are written in full
+ */
+char *ipv6_addr_to_str(char *result, const ipv6_addr_t *addr,
+                       uint8_t result_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NET_IPV6_ADDR_H */
+/** @} */
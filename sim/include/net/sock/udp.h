@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       Host replacement of RIOT's net/sock/udp.h for the simulator
+ *
+ * @}
+ */
+
+#ifndef NET_SOCK_UDP_H
+#define NET_SOCK_UDP_H
+
+#include <stdint.h>
+
+#include "net/ipv6/addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief UDP end point
+ */
+typedef struct {
+    int family;
+    union {
+        uint8_t ipv6[16];
+    } addr;
+    uint16_t netif;
+    uint16_t port;
+} sock_udp_ep_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NET_SOCK_UDP_H */
+/** @} */
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       Host replacement of RIOT's xtimer.h for the simulator
+ *
+ * Only the current time is provided, it is the simulated time.
+ *
+ * @}
+ */
+
+#ifndef XTIMER_H
+#define XTIMER_H
+
+#include <stdint.h>
+
+#include "kernel_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define US_PER_MS   (1000U)
+#define US_PER_SEC  (1000000U)
+#define MS_PER_SEC  (1000U)
+
+/**
+ * @brief Get simulated time in us, wraps like on RIOT
+ */
+uint32_t xtimer_now_usec(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XTIMER_H */
+/** @} */
@@ -0,0 +1,1323 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       Discrete-event simulator of the leader election
+ *
+ * Runs the state machine of `src/fsm.c` for many nodes on one link in a
+ * single process. The network API of elect.h is replaced by events of a
+ * priority queue, with configurable loss, latency, and node churn. Nodes
+ * are identified by link local addresses, the lower 32 bit of the interface
+ * ID are the index of the node, the upper 32 bit are random so that the
+ * order of addresses is independent of the index.
+ *
+ * Multicasts are delivered to all receivers at the same time, each
+ * receiver loses them independently. Requests of a unicast poll round are
+ * spread across the interval like in `src/poll.c`, without limiting the
+ * requests in flight.
+ *
+ * The network has converged if there is exactly one coordinator, and all
+ * other nodes that are up are clients of it and registered as its members.
+ *
+ * @}
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "xtimer.h"
+
+#include "elect.h"
+
+/**
+ * @name Simulation events
+ * @{
+ */
+#define SIM_EV_TIMER        (0U)    /**< timer of node, arg: timer, gen */
+#define SIM_EV_BOOT         (1U)    /**< node (re)boots */
+#define SIM_EV_FAIL         (2U)    /**< node fails */
+#define SIM_EV_BCAST        (3U)    /**< node ID multicast from src, arg: ID */
+#define SIM_EV_GROUP_GET    (4U)    /**< sensor group request from src */
+#define SIM_EV_GET          (5U)    /**< sensor request from src */
+#define SIM_EV_OBSERVE      (6U)    /**< observe registration from src */
+#define SIM_EV_SAMPLE       (7U)    /**< sensor value from src */
+#define SIM_EV_PUT          (8U)    /**< registration of src */
+#define SIM_EV_POLL         (9U)    /**< paced poll request, arg: member, gen */
+#define SIM_EV_PROBE        (10U)   /**< check for convergence */
+#define SIM_EV_PARENT       (11U)   /**< registration redirect, arg: parent */
+#define SIM_EV_STANDBY      (12U)   /**< standby announcement of src, value:
+                                         epoch, arg: standby + 1 or 0 */
+#define SIM_EV_SYNC         (13U)   /**< members sent to standby, arg: slot */
+#define SIM_EV_AGGREGATE    (14U)   /**< aggregate of src, arg: epoch, sum: interval */
+#define SIM_EV_NODES_GET    (15U)   /**< block of members asked by src, arg:
+                                         first member */
+#define SIM_EV_NODES        (16U)   /**< block of members of src, arg: slot */
+#define SIM_EV_REG_ACK      (17U)   /**< registration acknowledged by src */
+#define SIM_EV_ANNOUNCE     (18U)   /**< re-announce of src, value: epoch,
+                                         arg: size of its table */
+#define SIM_EV_NODES_TIMEOUT (19U)  /**< GET /nodes of node timed out, sent:
+                                         time of request */
+#define SIM_EV_LEISURE      (20U)   /**< group response of node is due, gen */
+/** @} */
+
+/**
+ * @name Messages counted by the simulator
+ * @{
+ */
+#define SIM_MSG_BCAST       (0U)    /**< node ID multicasts */
+#define SIM_MSG_PUT         (1U)    /**< registrations */
+#define SIM_MSG_GET         (2U)    /**< unicast sensor requests */
+#define SIM_MSG_GROUP_GET   (3U)    /**< sensor group requests */
+#define SIM_MSG_OBSERVE     (4U)    /**< observe registrations */
+#define SIM_MSG_SAMPLE      (5U)    /**< sensor responses and notifications */
+#define SIM_MSG_AGGREGATE   (6U)    /**< aggregate multicasts */
+#define SIM_MSG_STANDBY     (7U)    /**< standby announcements */
+#define SIM_MSG_SYNC        (8U)    /**< members sent to standby */
+#define SIM_MSG_NODES       (9U)    /**< blocks of members fetched */
+#define SIM_MSG_ANNOUNCE    (10U)   /**< re-announces of registered nodes */
+#define SIM_MSG_NUMOF       (11U)
+/** @} */
+
+static const char *sim_msg_names[SIM_MSG_NUMOF] = {
+    "bcast_id", "put_node", "get_sensor", "get_group", "observe", "sample",
+    "aggregate", "standby", "sync", "get_nodes", "announce",
+};
+
+/**
+ * @brief Number of member chunks in flight to standby nodes
+ */
+#define SIM_SYNC_NUM        (64U)
+
+/**
+ * @brief Number of blocks of members in flight to new coordinators
+ */
+#define SIM_BLOCK_NUM       (64U)
+
+/**
+ * @brief Time in us after which gcoap gives up on a NON request
+ */
+#define SIM_COAP_TIMEOUT    (5U * US_PER_SEC)
+
+/**
+ * @brief Event in the priority queue
+ */
+typedef struct {
+    uint64_t time;      /**< time of event in us */
+    uint32_t seq;       /**< insertion order, events at same time are FIFO */
+    uint32_t node;      /**< node handling the event */
+    uint32_t src;       /**< sending node of messages */
+    uint32_t arg;       /**< timer or member position */
+    uint32_t gen;       /**< generation, stale events are ignored */
+    uint16_t type;      /**< event type, see SIM_EV_* */
+    int16_t value;      /**< sensor value of samples */
+    int32_t sum;        /**< sum of partial aggregate of samples */
+    uint16_t count;     /**< number of values in partial aggregate */
+    uint64_t sent;      /**< send time of messages */
+    uint64_t req;       /**< send time of the request a sample responds to,
+                             0 for notifications */
+} sim_event_t;
+
+/**
+ * @brief Simulated node
+ */
+typedef struct {
+    elect_fsm_t fsm;                    /**< state machine under test */
+    ipv6_addr_t addr;                   /**< link local address */
+    bool up;                            /**< node is running */
+    elect_dedup_t dedup;                /**< recent senders, see listener */
+    uint32_t gen[ELECT_TIMER_NUMOF];    /**< generation of timers */
+    uint32_t poll_gen;                  /**< generation of poll round */
+    uint32_t observer;                  /**< index+1 of observer, 0 if none */
+    int16_t obs_value;                  /**< last value notified */
+    uint32_t obs_time;                  /**< time of last notification in ms */
+    uint16_t seq;                       /**< sequence of samples */
+    uint64_t aggr_time;                 /**< time aggregate was cached, 0 if none */
+    uint16_t aggr_interval;             /**< interval of cached aggregate in ms */
+    uint32_t leisure_gen;               /**< generation of deferred response */
+    int16_t base;                       /**< mean of sensor values */
+    int32_t part_sum;                   /**< partial aggregate of group head */
+    uint16_t part_count;                /**< values in partial aggregate */
+    uint64_t req_sent;                  /**< send time of request answered */
+    uint64_t fetch_sent;                /**< send time of pending GET /nodes,
+                                             0 if none */
+    uint32_t parent;                    /**< index+1 of node registered with */
+    uint64_t round_begin;               /**< start of current poll round */
+    unsigned round_pending;             /**< members yet to respond */
+    /* membership table, allocated when first used */
+    elect_member_t *members;
+    uint32_t *member_pos;               /**< position+1 of node in members */
+    unsigned members_num;
+} sim_node_t;
+
+/**
+ * @brief Simulation parameters
+ */
+static struct {
+    unsigned nodes;         /**< number of nodes */
+    double loss;            /**< loss probability per receiver */
+    uint32_t latency;       /**< mean latency in us */
+    uint32_t jitter;        /**< max. deviation from latency in us */
+    double mtbf;            /**< mean time between failures of a node in s */
+    double downtime;        /**< mean time a failed node is down in s */
+    double boot;            /**< nodes boot uniformly within this time in s */
+    double duration;        /**< simulated time in s */
+    uint32_t probe;         /**< interval of convergence checks in us */
+    bool kill_leader;       /**< kill coordinator after first convergence */
+    uint64_t seed;          /**< seed of random number generator */
+} cfg = {
+    .nodes      = 10,
+    .loss       = 0.0,
+    .latency    = 5000,
+    .jitter     = 2000,
+    .mtbf       = 0.0,
+    .downtime   = 30.0,
+    .boot       = 1.0,
+    .duration   = 120.0,
+    .probe      = 100000,
+    .kill_leader = false,
+    .seed       = 1,
+};
+
+static sim_node_t *nodes;
+static sim_node_t *cur;
+static uint64_t now;
+static uint64_t rng;
+
+static sim_event_t *heap;
+static size_t heap_len;
+static size_t heap_size;
+static uint32_t heap_seq;
+
+static uint64_t msg_counts[SIM_MSG_NUMOF];
+static elect_sync_t sync_pool[SIM_SYNC_NUM];
+static unsigned sync_next;
+static elect_block_t block_pool[SIM_BLOCK_NUM];
+static unsigned block_next;
+static uint64_t stats_counts[ELECT_STATS_NUMOF];
+static uint64_t events_handled;
+static uint64_t round_count;
+static uint64_t round_sum;
+static uint64_t round_max;
+/* intervals elapsed on all running nodes, each as long as the one in effect */
+static double node_intervals;
+
+/* convergence tracking */
+static bool converged;
+static int64_t first_converged = -1;
+static int64_t killed_at = -1;
+static int64_t recovered = -1;
+static uint64_t lost_at;
+static uint64_t outages;
+static uint64_t outage_sum;
+static uint64_t outage_max;
+static uint64_t probes;
+static uint64_t probes_converged;
+
+/* accuracy of aggregates, against the mean of sensor values of live nodes */
+static int64_t base_sum;
+static unsigned base_up;
+static double aggr_err_sum;
+static double aggr_err_max;
+static uint64_t aggr_err_count;
+
+/* --- random numbers --- */
+
+static uint64_t _rand(void)
+{
+    /* xorshift64* */
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return rng * 0x2545f4914f6cdd1dULL;
+}
+
+static double _rand_unit(void)
+{
+    return (double)(_rand() >> 11) / (double)(1ULL << 53);
+}
+
+static uint64_t _rand_exp(double mean)
+{
+    return (uint64_t)(-mean * log(1.0 - _rand_unit()) * US_PER_SEC);
+}
+
+static bool _lost(void)
+{
+    return (cfg.loss > 0.0) && (_rand_unit() < cfg.loss);
+}
+
+static uint64_t _latency(void)
+{
+    uint64_t low = (cfg.latency > cfg.jitter) ? cfg.latency - cfg.jitter : 0;
+    return low + (_rand() % (cfg.latency + cfg.jitter - low + 1));
+}
+
+/* --- priority queue --- */
+
+static bool _before(const sim_event_t *a, const sim_event_t *b)
+{
+    return (a->time < b->time) || ((a->time == b->time) && (a->seq < b->seq));
+}
+
+static void _push(sim_event_t ev)
+{
+    if (heap_len == heap_size) {
+        heap_size = heap_size ? 2 * heap_size : 1024;
+        heap = realloc(heap, heap_size * sizeof(sim_event_t));
+        if (heap == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    ev.seq = heap_seq++;
+    size_t i = heap_len++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!_before(&ev, &heap[parent])) {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = ev;
+}
+
+static sim_event_t _pop(void)
+{
+    sim_event_t top = heap[0];
+    sim_event_t last = heap[--heap_len];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= heap_len) {
+            break;
+        }
+        if ((child + 1 < heap_len) && _before(&heap[child + 1], &heap[child])) {
+            child++;
+        }
+        if (!_before(&heap[child], &last)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+/* --- nodes and messages --- */
+
+static uint32_t _index(const sim_node_t *node)
+{
+    return (uint32_t)(node - nodes);
+}
+
+/**
+ * @brief Get node by address, NULL if there is none
+ */
+static sim_node_t *_node(const ipv6_addr_t *addr)
+{
+    uint32_t idx = ((uint32_t)addr->u8[12] << 24) |
+                   ((uint32_t)addr->u8[13] << 16) |
+                   ((uint32_t)addr->u8[14] << 8) | addr->u8[15];
+    if ((idx == 0) || (idx > cfg.nodes) ||
+        (memcmp(&nodes[idx - 1].addr, addr, sizeof(ipv6_addr_t)) != 0)) {
+        return NULL;
+    }
+    return &nodes[idx - 1];
+}
+
+/**
+ * @brief Send unicast message from current node, unless it is lost
+ */
+static void _unicast(uint16_t type, sim_node_t *dst, int16_t value,
+                     uint32_t arg)
+{
+    if ((dst == NULL) || _lost()) {
+        return;
+    }
+    sim_event_t ev = {
+        .time = now + _latency(), .node = _index(dst), .src = _index(cur),
+        .type = type, .value = value, .arg = arg, .sent = now,
+    };
+    if (type == SIM_EV_SAMPLE) {
+        ev.sum = cur->part_sum;
+        ev.count = cur->part_count;
+        ev.req = cur->req_sent;
+    }
+    _push(ev);
+}
+
+/**
+ * @brief Send multicast from current node, loss is applied per receiver
+ */
+static void _multicast(uint16_t type, int16_t value, uint32_t arg)
+{
+    sim_event_t ev = {
+        .time = now + _latency(), .node = _index(cur), .src = _index(cur),
+        .type = type, .value = value, .arg = arg, .sent = now,
+    };
+    _push(ev);
+}
+
+static void _handle(sim_node_t *node, uint16_t type, void *content)
+{
+    sim_node_t *prev = cur;
+    cur = node;
+    fsm_handle(&node->fsm, type, content);
+    events_handled++;
+    cur = prev;
+}
+
+static void _timer_push(sim_node_t *node, unsigned timer, uint64_t offset)
+{
+    sim_event_t ev = {
+        .time = now + offset, .node = _index(node), .type = SIM_EV_TIMER,
+        .arg = timer, .gen = node->gen[timer],
+    };
+    _push(ev);
+}
+
+static void _boot(sim_node_t *node)
+{
+    node->up = true;
+    dedup_init(&node->dedup);
+    base_sum += node->base;
+    base_up++;
+    node->observer = 0;
+    node->aggr_time = 0;
+    node->members_num = 0;
+    node->round_pending = 0;
+    node->part_count = 0;
+    node->parent = 0;
+    node->poll_gen++;
+    cur = node;
+    fsm_init(&node->fsm, &node->addr);
+    /* initial `TICK`, like setup() on RIOT */
+    node->gen[ELECT_TIMER_INTERVAL]++;
+    _timer_push(node, ELECT_TIMER_INTERVAL, 0);
+    if (cfg.mtbf > 0.0) {
+        sim_event_t ev = {
+            .time = now + _rand_exp(cfg.mtbf), .node = _index(node),
+            .type = SIM_EV_FAIL,
+        };
+        _push(ev);
+    }
+}
+
+static void _fail(sim_node_t *node, bool reboot)
+{
+    node->up = false;
+    base_sum -= node->base;
+    base_up--;
+    for (unsigned i = 0; i < ELECT_TIMER_NUMOF; ++i) {
+        node->gen[i]++;
+    }
+    node->poll_gen++;
+    node->leisure_gen++;
+    if (reboot) {
+        sim_event_t ev = {
+            .time = now + _rand_exp(cfg.downtime), .node = _index(node),
+            .type = SIM_EV_BOOT,
+        };
+        _push(ev);
+    }
+}
+
+/**
+ * @brief Send the sensor response of @p node to @p dst
+ */
+static void _sensor_resp(sim_node_t *node, sim_node_t *dst, uint64_t sent)
+{
+    cur = node;
+    int16_t value = sensor_read();
+    if (node->part_count) {
+        value = (int16_t)(node->part_sum / node->part_count);
+    }
+    node->seq++;
+    msg_counts[SIM_MSG_SAMPLE]++;
+    node->req_sent = sent;
+    _unicast(SIM_EV_SAMPLE, dst, value, node->seq);
+    node->req_sent = 0;
+}
+
+/**
+ * @brief Reply to a sensor request of @p src, as done by _sensor_handler
+ */
+static void _sensor_req(sim_node_t *node, sim_node_t *src, uint64_t sent)
+{
+    _handle(node, ELECT_LEADER_ALIVE_EVENT, NULL);
+    _sensor_resp(node, src, sent);
+}
+
+/**
+ * @brief Defer the response to a group request by a random Leisure, as
+ *        done by _sensor_handler
+ */
+static void _sensor_defer(sim_node_t *node)
+{
+    _handle(node, ELECT_LEADER_ALIVE_EVENT, NULL);
+    uint32_t interval = node->aggr_time ? node->aggr_interval
+                                        : ELECT_MSG_INTERVAL;
+    uint64_t max = (uint64_t)interval * ELECT_COAP_LEISURE / 100U * US_PER_MS;
+    /* a response still waiting belongs to an older round, it is replaced */
+    node->leisure_gen++;
+    sim_event_t ev = {
+        .time = now + (uint64_t)(_rand_unit() * max), .node = _index(node),
+        .type = SIM_EV_LEISURE, .gen = node->leisure_gen,
+    };
+    _push(ev);
+}
+
+static void _deliver_multicast(const sim_event_t *ev)
+{
+    sim_node_t *src = &nodes[ev->src];
+    for (uint32_t i = 0; i < cfg.nodes; ++i) {
+        sim_node_t *node = &nodes[i];
+        if ((node == src) || !node->up || _lost()) {
+            continue;
+        }
+        if (ev->type == SIM_EV_BCAST) {
+            /* IDs of other nodes are relayed gossip, see listener */
+            ipv6_addr_t addr = nodes[ev->arg].addr;
+            if (dedup_check(&node->dedup, &src->addr.u8[ELECT_FRAME_IID_LEN],
+                            &addr, (uint32_t)(now / US_PER_MS))) {
+                stats_counts[ELECT_STATS_BCAST_DUP]++;
+                continue;
+            }
+            _handle(node, (ev->arg == ev->src) ? ELECT_BROADCAST_EVENT
+                                               : ELECT_RELAY_EVENT, &addr);
+        }
+        else if (ev->type == SIM_EV_STANDBY) {
+            elect_standby_t ann = {
+                .epoch = (uint16_t)ev->value, .leader = src->addr,
+            };
+            if (ev->arg) {
+                ann.standby = nodes[ev->arg - 1].addr;
+            }
+            else {
+                ipv6_addr_set_unspecified(&ann.standby);
+            }
+            _handle(node, ELECT_STANDBY_EVENT, &ann);
+        }
+        else if (ev->type == SIM_EV_AGGREGATE) {
+            elect_aggregate_t aggr = {
+                .epoch = (uint16_t)ev->arg, .value = ev->value,
+                .interval = (uint16_t)ev->sum, .leader = src->addr,
+            };
+            _handle(node, ELECT_AGGREGATE_EVENT, &aggr);
+        }
+        else if (ELECT_COAP_LEISURE > 0) {
+            _sensor_defer(node);
+        }
+        else {
+            _sensor_req(node, src, ev->sent);
+        }
+    }
+}
+
+/* --- convergence --- */
+
+/**
+ * @brief Check if node is registered with coordinator, or with a group
+ *        head that is registered with it
+ */
+static bool _registered(sim_node_t *node, sim_node_t *coord)
+{
+    if (node->parent == 0) {
+        return false;
+    }
+    sim_node_t *parent = &nodes[node->parent - 1];
+    bool result = false;
+    cur = parent;
+    if (parent->up && (members_find(&node->addr) != NULL)) {
+        result = (parent == coord) ||
+                 ((parent->fsm.state == ELECT_STATE_CLIENT) &&
+                  (parent->parent == _index(coord) + 1));
+        if (result && (parent != coord)) {
+            cur = coord;
+            result = (members_find(&parent->addr) != NULL);
+        }
+    }
+    return result;
+}
+
+static bool _is_converged(void)
+{
+    sim_node_t *coord = NULL;
+    for (uint32_t i = 0; i < cfg.nodes; ++i) {
+        if (nodes[i].up && (nodes[i].fsm.state == ELECT_STATE_COORDINATOR)) {
+            if (coord != NULL) {
+                return false;
+            }
+            coord = &nodes[i];
+        }
+    }
+    if (coord == NULL) {
+        return false;
+    }
+    sim_node_t *prev = cur;
+    cur = coord;
+    bool result = true;
+    for (uint32_t i = 0; result && (i < cfg.nodes); ++i) {
+        sim_node_t *node = &nodes[i];
+        if (!node->up || (node == coord)) {
+            continue;
+        }
+        result = (node->fsm.state == ELECT_STATE_CLIENT) &&
+                 (ipv6_addr_cmp(&node->fsm.coordinator, &coord->addr) == 0) &&
+                 _registered(node, coord);
+    }
+    cur = prev;
+    return result;
+}
+
+/**
+ * @brief Share of running nodes that can read an aggregate locally, not
+ *        older than the leader timeout
+ */
+static double _cached(void)
+{
+    unsigned up = 0;
+    unsigned cached = 0;
+    for (uint32_t i = 0; i < cfg.nodes; ++i) {
+        if (!nodes[i].up) {
+            continue;
+        }
+        up++;
+        if (nodes[i].aggr_time &&
+            ((now - nodes[i].aggr_time) < ELECT_LEADER_TIMEOUT * US_PER_MS)) {
+            cached++;
+        }
+    }
+    return up ? (double)cached / up : 0.0;
+}
+
+/**
+ * @brief Get fraction of nodes registered with the highest coordinator
+ */
+static double _coverage(void)
+{
+    sim_node_t *coord = NULL;
+    unsigned up = 0;
+    unsigned registered = 0;
+    for (uint32_t i = 0; i < cfg.nodes; ++i) {
+        sim_node_t *node = &nodes[i];
+        if (!node->up) {
+            continue;
+        }
+        up++;
+        if ((node->fsm.state == ELECT_STATE_COORDINATOR) &&
+            ((coord == NULL) ||
+             (ipv6_addr_cmp(&coord->addr, &node->addr) < 0))) {
+            coord = node;
+        }
+    }
+    if ((coord == NULL) || (up < 2)) {
+        return (up == 1) && coord ? 1.0 : 0.0;
+    }
+    for (uint32_t i = 0; i < cfg.nodes; ++i) {
+        if (nodes[i].up && (&nodes[i] != coord) &&
+            _registered(&nodes[i], coord)) {
+            registered++;
+        }
+    }
+    cur = NULL;
+    return (double)registered / (up - 1);
+}
+
+static void _probe(void)
+{
+    bool result = _is_converged();
+    for (uint32_t i = 0; i < cfg.nodes; ++i) {
+        if (nodes[i].up) {
+            uint32_t interval = fsm_interval(&nodes[i].fsm);
+            node_intervals += (double)cfg.probe / interval / US_PER_MS;
+        }
+    }
+    probes++;
+    if (result) {
+        probes_converged++;
+    }
+    if (result && !converged) {
+        if (first_converged < 0) {
+            first_converged = (int64_t)now;
+            if (cfg.kill_leader) {
+                for (uint32_t i = 0; i < cfg.nodes; ++i) {
+                    if (nodes[i].fsm.state == ELECT_STATE_COORDINATOR) {
+                        _fail(&nodes[i], false);
+                    }
+                }
+                killed_at = (int64_t)now;
+                result = false;
+                lost_at = now;
+            }
+        }
+        else {
+            uint64_t outage = now - lost_at;
+            outages++;
+            outage_sum += outage;
+            if (outage > outage_max) {
+                outage_max = outage;
+            }
+            if ((killed_at >= 0) && (recovered < 0)) {
+                recovered = (int64_t)now;
+            }
+        }
+    }
+    else if (!result && converged) {
+        lost_at = now;
+    }
+    converged = result;
+}
+
+/* --- API of elect.h, as used by the state machine --- */
+
+uint32_t xtimer_now_usec(void)
+{
+    return (uint32_t)now;
+}
+
+void sim_log(unsigned level, const char *format, ...)
+{
+    (void)level;
+    va_list args;
+    printf("%10.6f %5" PRIu32 ": ", (double)now / US_PER_SEC,
+           cur ? _index(cur) : 0);
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+char *ipv6_addr_to_str(char *result, const ipv6_addr_t *addr,
+                       uint8_t result_len)
+{
+    if (result_len < IPV6_ADDR_MAX_STR_LEN) {
+        return NULL;
+    }
+    char *pos = result;
+    for (unsigned i = 0; i < 16; i += 2) {
+        pos += sprintf(pos, "%s%x", i ? ":" : "",
+                       ((unsigned)addr->u8[i] << 8) | addr->u8[i + 1]);
+    }
+    return result;
+}
+
+int ipv6_addr_cmp(const ipv6_addr_t *ip1, const ipv6_addr_t *ip2)
+{
+    return memcmp(ip1, ip2, sizeof(ipv6_addr_t));
+}
+
+void fsm_timer_set(unsigned timer, uint32_t offset)
+{
+    cur->gen[timer]++;
+    _timer_push(cur, timer, (uint64_t)offset * US_PER_MS);
+}
+
+void fsm_timer_stop(unsigned timer)
+{
+    cur->gen[timer]++;
+}
+
+uint32_t random_uint32_range(uint32_t a, uint32_t b)
+{
+    return a + (uint32_t)(_rand() % (b - a));
+}
+
+int16_t sensor_read(void)
+{
+    return cur->base + (int16_t)(_rand() % 5) - 2;
+}
+
+int broadcast_id(const ipv6_addr_t *ip)
+{
+    sim_node_t *node = _node(ip);
+    if (node == NULL) {
+        return 1;
+    }
+    msg_counts[SIM_MSG_BCAST]++;
+    stats_inc(ELECT_STATS_BCAST_TX);
+    _multicast(SIM_EV_BCAST, 0, _index(node));
+    return 0;
+}
+
+int broadcast_sensor(uint16_t epoch, const ipv6_addr_t *leader, int16_t value,
+                     uint32_t interval)
+{
+    (void)leader;
+    msg_counts[SIM_MSG_AGGREGATE]++;
+    if (converged && (base_up > 0)) {
+        double err = fabs(value - (double)base_sum / base_up);
+        aggr_err_sum += err;
+        aggr_err_count++;
+        if (err > aggr_err_max) {
+            aggr_err_max = err;
+        }
+    }
+    sim_event_t ev = {
+        .time = now + _latency(), .node = _index(cur), .src = _index(cur),
+        .type = SIM_EV_AGGREGATE, .value = value, .arg = epoch,
+        .sum = (int32_t)interval, .sent = now,
+    };
+    _push(ev);
+    return 0;
+}
+
+int broadcast_standby(uint16_t epoch, const ipv6_addr_t *leader,
+                      const ipv6_addr_t *standby)
+{
+    (void)leader;
+    sim_node_t *node = _node(standby);
+    msg_counts[SIM_MSG_STANDBY]++;
+    _multicast(SIM_EV_STANDBY, (int16_t)epoch, node ? _index(node) + 1 : 0);
+    return 0;
+}
+
+int coap_put_standby(ipv6_addr_t addr, const ipv6_addr_t *members,
+                     unsigned num)
+{
+    /* chunks are delivered long before the pool wraps around */
+    elect_sync_t *sync = &sync_pool[sync_next];
+    sync->num = num;
+    memcpy(sync->nodes, members, num * sizeof(ipv6_addr_t));
+    msg_counts[SIM_MSG_SYNC]++;
+    _unicast(SIM_EV_SYNC, _node(&addr), 0, sync_next);
+    sync_next = (sync_next + 1) % SIM_SYNC_NUM;
+    return 0;
+}
+
+int coap_put_node(ipv6_addr_t addr, ipv6_addr_t node, unsigned members)
+{
+    (void)node;
+    msg_counts[SIM_MSG_PUT]++;
+    _unicast(SIM_EV_PUT, _node(&addr), 0, members);
+    return 0;
+}
+
+int coap_announce_node(ipv6_addr_t addr, ipv6_addr_t node, unsigned members,
+                       uint16_t epoch)
+{
+    (void)node;
+    msg_counts[SIM_MSG_ANNOUNCE]++;
+    _unicast(SIM_EV_ANNOUNCE, _node(&addr), (int16_t)epoch, members);
+    return 0;
+}
+
+int coap_get_nodes(ipv6_addr_t addr, unsigned first)
+{
+    msg_counts[SIM_MSG_NODES]++;
+    _unicast(SIM_EV_NODES_GET, _node(&addr), 0, first);
+    /* the memo times out unless the response arrives before */
+    cur->fetch_sent = now;
+    sim_event_t ev = {
+        .time = now + SIM_COAP_TIMEOUT, .node = _index(cur),
+        .type = SIM_EV_NODES_TIMEOUT, .sent = now,
+    };
+    _push(ev);
+    return 0;
+}
+
+int coap_get_sensor(ipv6_addr_t addr)
+{
+    msg_counts[SIM_MSG_GET]++;
+    stats_inc(ELECT_STATS_POLL_TX);
+    _unicast(SIM_EV_GET, _node(&addr), 0, 0);
+    return 0;
+}
+
+int coap_get_sensor_group(void)
+{
+    msg_counts[SIM_MSG_GROUP_GET]++;
+    stats_inc(ELECT_STATS_POLL_TX);
+    _multicast(SIM_EV_GROUP_GET, 0, 0);
+    return 0;
+}
+
+int coap_observe_sensor(ipv6_addr_t addr)
+{
+    msg_counts[SIM_MSG_OBSERVE]++;
+    stats_inc(ELECT_STATS_POLL_TX);
+    _unicast(SIM_EV_OBSERVE, _node(&addr), 0, 0);
+    return 0;
+}
+
+int coap_notify_sensor(uint32_t max_age)
+{
+    if (cur->observer == 0) {
+        return 1;
+    }
+    int16_t value = sensor_read();
+    uint32_t time = xtimer_now_usec() / US_PER_MS;
+    if ((abs(value - cur->obs_value) < ELECT_OBS_DELTA) &&
+        ((time - cur->obs_time) < max_age)) {
+        return 0;
+    }
+    cur->obs_value = value;
+    cur->obs_time = time;
+    cur->seq++;
+    msg_counts[SIM_MSG_SAMPLE]++;
+    _unicast(SIM_EV_SAMPLE, &nodes[cur->observer - 1], value, cur->seq);
+    return 0;
+}
+
+void coap_set_aggregate(const elect_aggregate_t *aggr)
+{
+    cur->aggr_time = now;
+    cur->aggr_interval = aggr->interval;
+}
+
+void listen_dedup_window(uint32_t ms)
+{
+    cur->dedup.window = ms;
+}
+
+void coap_set_partial(int32_t sum, uint16_t count)
+{
+    cur->part_sum = sum;
+    cur->part_count = count;
+}
+
+void poll_start(uint32_t interval)
+{
+    unsigned count = members_count();
+    cur->poll_gen++;
+    if (count == 0) {
+        return;
+    }
+    uint64_t gap = (uint64_t)interval * US_PER_MS *
+                   ELECT_POLL_SPREAD / 100U / count;
+    for (unsigned i = 0; i < count; ++i) {
+        uint64_t jitter = gap ? _rand() % (gap / 2 + 1) : 0;
+        sim_event_t ev = {
+            .time = now + i * gap + jitter, .node = _index(cur),
+            .type = SIM_EV_POLL, .arg = i, .gen = cur->poll_gen,
+        };
+        _push(ev);
+    }
+}
+
+void poll_tick(void)
+{
+}
+
+void poll_done(void)
+{
+}
+
+void poll_stop(void)
+{
+    cur->poll_gen++;
+}
+
+void members_clear(void)
+{
+    for (unsigned i = 0; i < cur->members_num; ++i) {
+        cur->member_pos[cur->members[i].iid] = 0;
+    }
+    cur->members_num = 0;
+}
+
+unsigned members_count(void)
+{
+    return cur->members_num;
+}
+
+elect_member_t *members_get(unsigned idx)
+{
+    return (idx < cur->members_num) ? &cur->members[idx] : NULL;
+}
+
+elect_member_t *members_find(const ipv6_addr_t *addr)
+{
+    sim_node_t *node = _node(addr);
+    if ((node == NULL) || (cur->member_pos == NULL)) {
+        return NULL;
+    }
+    uint32_t pos = cur->member_pos[_index(node) + 1];
+    return pos ? &cur->members[pos - 1] : NULL;
+}
+
+elect_member_t *members_add(const ipv6_addr_t *addr, bool *is_new)
+{
+    sim_node_t *node = _node(addr);
+    *is_new = false;
+    if (node == NULL) {
+        return NULL;
+    }
+    if (cur->member_pos == NULL) {
+        cur->members = calloc(cfg.nodes, sizeof(elect_member_t));
+        cur->member_pos = calloc(cfg.nodes + 1, sizeof(uint32_t));
+        if ((cur->members == NULL) || (cur->member_pos == NULL)) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    uint32_t idx = _index(node) + 1;
+    if (cur->member_pos[idx]) {
+        return &cur->members[cur->member_pos[idx] - 1];
+    }
+    if (cur->members_num >= ELECT_MEMBERS_NUM) {
+        return NULL;
+    }
+    elect_member_t *member = &cur->members[cur->members_num++];
+    memset(member, 0, sizeof(*member));
+    /* index+1 of the node instead of its interface ID */
+    member->iid = idx;
+    cur->member_pos[idx] = cur->members_num;
+    *is_new = true;
+    return member;
+}
+
+int members_remove(const ipv6_addr_t *addr)
+{
+    elect_member_t *member = members_find(addr);
+    if (member == NULL) {
+        return 1;
+    }
+    /* keep table dense by moving last entry into the gap */
+    unsigned pos = (unsigned)(member - cur->members);
+    cur->member_pos[member->iid] = 0;
+    if (pos != --cur->members_num) {
+        *member = cur->members[cur->members_num];
+        cur->member_pos[member->iid] = pos + 1;
+    }
+    return 0;
+}
+
+void members_addr(const elect_member_t *member, ipv6_addr_t *addr)
+{
+    *addr = nodes[member->iid - 1].addr;
+}
+
+void stats_inc(unsigned counter)
+{
+    if (counter < ELECT_STATS_NUMOF) {
+        stats_counts[counter]++;
+    }
+}
+
+void stats_round_start(unsigned members)
+{
+    if (cur->round_pending > 0) {
+        stats_inc(ELECT_STATS_ROUND_INCOMPLETE);
+    }
+    cur->round_begin = now;
+    cur->round_pending = members;
+}
+
+void stats_round_resp(void)
+{
+    if ((cur->round_pending > 0) && (--cur->round_pending == 0)) {
+        uint64_t lat = now - cur->round_begin;
+        round_count++;
+        round_sum += lat;
+        if (lat > round_max) {
+            round_max = lat;
+        }
+    }
+}
+
+/* --- simulation --- */
+
+static const uint16_t timer_types[ELECT_TIMER_NUMOF] = {
+    [ELECT_TIMER_INTERVAL]          = ELECT_INTERVAL_EVENT,
+    [ELECT_TIMER_LEADER_TIMEOUT]    = ELECT_LEADER_TIMEOUT_EVENT,
+    [ELECT_TIMER_LEADER_THRESHOLD]  = ELECT_LEADER_THRESHOLD_EVENT,
+    [ELECT_TIMER_GOSSIP]            = ELECT_GOSSIP_EVENT,
+    [ELECT_TIMER_REGISTER]          = ELECT_REGISTER_EVENT,
+};
+
+static void _run(void)
+{
+    uint64_t end = (uint64_t)(cfg.duration * US_PER_SEC);
+    while ((heap_len > 0) && (heap[0].time <= end)) {
+        sim_event_t ev = _pop();
+        sim_node_t *node = &nodes[ev.node];
+        now = ev.time;
+        cur = node;
+        if ((ev.type != SIM_EV_PROBE) && (ev.type != SIM_EV_BOOT) &&
+            (ev.type != SIM_EV_BCAST) && (ev.type != SIM_EV_GROUP_GET) &&
+            (ev.type != SIM_EV_STANDBY) && (ev.type != SIM_EV_AGGREGATE) &&
+            !node->up) {
+            continue;
+        }
+        switch (ev.type) {
+            case SIM_EV_TIMER:
+                if (ev.gen == node->gen[ev.arg]) {
+                    _handle(node, timer_types[ev.arg], NULL);
+                }
+                break;
+            case SIM_EV_BOOT:
+                _boot(node);
+                break;
+            case SIM_EV_FAIL:
+                _fail(node, true);
+                break;
+            case SIM_EV_BCAST:
+            case SIM_EV_GROUP_GET:
+            case SIM_EV_STANDBY:
+            case SIM_EV_AGGREGATE:
+                _deliver_multicast(&ev);
+                break;
+            case SIM_EV_GET:
+                _sensor_req(node, &nodes[ev.src], ev.sent);
+                break;
+            case SIM_EV_LEISURE:
+                /* as coap_put_sensor_group(), without round trip time */
+                if ((ev.gen == node->leisure_gen) &&
+                    (node->fsm.state == ELECT_STATE_CLIENT)) {
+                    _sensor_resp(node, _node(&node->fsm.coordinator), 0);
+                }
+                break;
+            case SIM_EV_OBSERVE:
+                node->observer = ev.src + 1;
+                node->obs_value = sensor_read();
+                node->obs_time = xtimer_now_usec() / US_PER_MS;
+                /* like on RIOT, the observe token carries no send time */
+                _sensor_req(node, &nodes[ev.src], 0);
+                break;
+            case SIM_EV_SAMPLE: {
+                elect_sample_t sample = {
+                    .time = xtimer_now_usec() / US_PER_MS,
+                    .seq = (uint16_t)ev.arg, .value = ev.value,
+                    .sum = ev.sum, .count = ev.count,
+                    .rtt = ev.req ? (uint32_t)(now - ev.req) : 0,
+                    .addr = nodes[ev.src].addr,
+                };
+                _handle(node, ELECT_SENSOR_EVENT, &sample);
+                break;
+            }
+            case SIM_EV_PUT:
+            case SIM_EV_ANNOUNCE: {
+                sim_node_t *src = &nodes[ev.src];
+                elect_reg_t reg = {
+                    .node = src->addr, .members = ev.arg,
+                    .renew = (ev.type == SIM_EV_ANNOUNCE),
+                    .epoch = (uint16_t)ev.value,
+                };
+                _handle(node, ELECT_NODES_EVENT, &reg);
+                cur = node;
+                if (members_find(&src->addr) != NULL) {
+                    src->parent = ev.node + 1;
+                }
+                if (!reg.accepted || (ev.type == SIM_EV_ANNOUNCE)) {
+                    /* error responses, and those to re-announces, are
+                     * dropped by the node */
+                    break;
+                }
+                /* response, counted with the request */
+                sim_node_t *parent = _node(&reg.parent);
+                if (parent != NULL) {
+                    _unicast(SIM_EV_PARENT, src, 0, _index(parent));
+                }
+                else {
+                    _unicast(SIM_EV_REG_ACK, src, 0, 0);
+                }
+                break;
+            }
+            case SIM_EV_REG_ACK: {
+                ipv6_addr_t addr = nodes[ev.src].addr;
+                _handle(node, ELECT_REGISTERED_EVENT, &addr);
+                break;
+            }
+            case SIM_EV_SYNC:
+                _handle(node, ELECT_SYNC_EVENT, &sync_pool[ev.arg]);
+                break;
+            case SIM_EV_NODES_GET: {
+                /* blocks are delivered long before the pool wraps around */
+                elect_block_t *blk = &block_pool[block_next];
+                blk->first = ev.arg;
+                blk->num = ELECT_NODES_BLOCK;
+                _handle(node, ELECT_LIST_EVENT, blk);
+                blk->node = node->addr;
+                cur = node;
+                _unicast(SIM_EV_NODES, &nodes[ev.src], 0, block_next);
+                block_next = (block_next + 1) % SIM_BLOCK_NUM;
+                break;
+            }
+            case SIM_EV_NODES:
+                node->fetch_sent = 0;
+                _handle(node, ELECT_SEED_EVENT, &block_pool[ev.arg]);
+                break;
+            case SIM_EV_NODES_TIMEOUT:
+                if (node->fetch_sent == ev.sent) {
+                    elect_block_t blk = { .num = 0, .lost = true };
+                    node->fetch_sent = 0;
+                    _handle(node, ELECT_SEED_EVENT, &blk);
+                }
+                break;
+            case SIM_EV_PARENT: {
+                ipv6_addr_t addr = nodes[ev.arg].addr;
+                _handle(node, ELECT_PARENT_EVENT, &addr);
+                break;
+            }
+            case SIM_EV_POLL:
+                if ((ev.gen == node->poll_gen) &&
+                    ((node->fsm.state == ELECT_STATE_COORDINATOR) ||
+                     (node->fsm.state == ELECT_STATE_CLIENT)) &&
+                    (ev.arg < members_count())) {
+                    ipv6_addr_t client;
+                    members_addr(members_get(ev.arg), &client);
+                    coap_get_sensor(client);
+                }
+                break;
+            case SIM_EV_PROBE:
+                _probe();
+                ev.time = now + cfg.probe;
+                _push(ev);
+                break;
+        }
+    }
+    now = end;
+}
+
+static void _report(void)
+{
+    uint64_t total = 0;
+    printf("nodes               %u\n", cfg.nodes);
+    printf("poll_mode           %u\n", (unsigned)ELECT_POLL_MODE);
+    printf("groups              %u\n", (unsigned)ELECT_GROUPS);
+    printf("aggr_mode           %u\n", (unsigned)ELECT_AGGR_MODE);
+    printf("timing              %u\n", (unsigned)ELECT_TIMING);
+    printf("loss                %.3f\n", cfg.loss);
+    printf("latency_ms          %.3f +- %.3f\n", cfg.latency / 1000.0,
+           cfg.jitter / 1000.0);
+    printf("mtbf_s              %.1f\n", cfg.mtbf);
+    printf("duration_s          %.1f\n", cfg.duration);
+    if (first_converged >= 0) {
+        printf("converged_s         %.3f\n",
+               (double)first_converged / US_PER_SEC);
+    }
+    else {
+        printf("converged_s         -\n");
+    }
+    if (killed_at >= 0) {
+        if (recovered >= 0) {
+            printf("recovery_s          %.3f\n",
+                   (double)(recovered - killed_at) / US_PER_SEC);
+        }
+        else {
+            printf("recovery_s          -\n");
+        }
+    }
+    printf("converged_at_end    %s\n", converged ? "yes" : "no");
+    printf("coverage_at_end     %.4f\n", _coverage());
+    printf("aggr_cached_at_end  %.4f\n", _cached());
+    if (probes > 0) {
+        printf("availability        %.4f\n",
+               (double)probes_converged / probes);
+    }
+    printf("outages             %" PRIu64 "\n", outages);
+    if (outages > 0) {
+        printf("outage_mean_s       %.3f\n",
+               (double)outage_sum / outages / US_PER_SEC);
+        printf("outage_max_s        %.3f\n", (double)outage_max / US_PER_SEC);
+    }
+    printf("role_changes        %" PRIu64 "\n",
+           stats_counts[ELECT_STATS_ROLE_CHANGE]);
+    for (unsigned i = 0; i < SIM_MSG_NUMOF; ++i) {
+        printf("msg_%-16s%" PRIu64 "\n", sim_msg_names[i], msg_counts[i]);
+        total += msg_counts[i];
+    }
+    printf("msg_total           %" PRIu64 "\n", total);
+    if (node_intervals > 0) {
+        printf("msg_per_node_intvl  %.3f\n", total / node_intervals);
+    }
+    if (aggr_err_count > 0) {
+        printf("aggr_error_mean     %.3f\n", aggr_err_sum / aggr_err_count);
+        printf("aggr_error_max      %.3f\n", aggr_err_max);
+    }
+    printf("rounds              %" PRIu64 "\n", round_count);
+    if (round_count > 0) {
+        printf("round_mean_ms       %.3f\n",
+               (double)round_sum / round_count / US_PER_MS);
+        printf("round_max_ms        %.3f\n", (double)round_max / US_PER_MS);
+    }
+    printf("events_handled      %" PRIu64 "\n", events_handled);
+    printf("bcast_dup           %" PRIu64 "\n",
+           stats_counts[ELECT_STATS_BCAST_DUP]);
+    printf("reg_retry           %" PRIu64 "\n",
+           stats_counts[ELECT_STATS_REG_RETRY]);
+}
+
+static void _usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-n nodes] [-l loss] [-d latency_ms] [-j jitter_ms]\n"
+            "          [-f mtbf_s] [-r downtime_s] [-b boot_s] [-t duration_s]\n"
+            "          [-p probe_ms] [-k] [-s seed]\n"
+            "  -k  kill the coordinator once converged, report recovery\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "n:l:d:j:f:r:b:t:p:ks:h")) != -1) {
+        switch (opt) {
+            case 'n': cfg.nodes = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 'l': cfg.loss = atof(optarg); break;
+            case 'd': cfg.latency = (uint32_t)(atof(optarg) * US_PER_MS); break;
+            case 'j': cfg.jitter = (uint32_t)(atof(optarg) * US_PER_MS); break;
+            case 'f': cfg.mtbf = atof(optarg); break;
+            case 'r': cfg.downtime = atof(optarg); break;
+            case 'b': cfg.boot = atof(optarg); break;
+            case 't': cfg.duration = atof(optarg); break;
+            case 'p': cfg.probe = (uint32_t)(atof(optarg) * US_PER_MS); break;
+            case 'k': cfg.kill_leader = true; break;
+            case 's': cfg.seed = strtoull(optarg, NULL, 10); break;
+            default:
+                _usage(argv[0]);
+                return 1;
+        }
+    }
+    if ((cfg.nodes == 0) || (cfg.nodes > UINT32_MAX - 1) || (cfg.probe == 0)) {
+        _usage(argv[0]);
+        return 1;
+    }
+    rng = cfg.seed ? cfg.seed : 1;
+    nodes = calloc(cfg.nodes, sizeof(sim_node_t));
+    if (nodes == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < cfg.nodes; ++i) {
+        sim_node_t *node = &nodes[i];
+        uint32_t idx = i + 1;
+        uint32_t high = (uint32_t)_rand();
+        ipv6_addr_set_link_local_prefix(&node->addr);
+        for (unsigned b = 0; b < 4; ++b) {
+            node->addr.u8[8 + b] = (uint8_t)(high >> (24 - 8 * b));
+            node->addr.u8[12 + b] = (uint8_t)(idx >> (24 - 8 * b));
+        }
+        node->base = (int16_t)(200 + (_rand() % 100));
+        sim_event_t ev = {
+            .time = (uint64_t)(_rand_unit() * cfg.boot * US_PER_SEC),
+            .node = i, .type = SIM_EV_BOOT,
+        };
+        _push(ev);
+    }
+    sim_event_t probe = { .time = cfg.probe, .type = SIM_EV_PROBE };
+    _push(probe);
+    _run();
+    cur = NULL;
+    _report();
+    return 0;
+}
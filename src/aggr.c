@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       Aggregation of sensor values in fixed point
+ *
+ * Values are accumulated in Q16.16 with 64 bit, which holds the sum of
+ * ELECT_MEMBERS_NUM values of 16 bit without overflow. Adding a sample
+ * takes a multiplication and shifts only; the single division takes place
+ * when the aggregate is read, which is once per round except for
+ * ELECT_AGGR_EWMA, which needs no division at all.
+ *
+ * For ELECT_AGGR_LAST the latest sample of each member is cached in its
+ * entry of the membership table, the running sum is corrected by the
+ * difference to the cached sample, so the mean of the latest values is
+ * kept in O(1) per sample.
+ *
+ * @}
+ */
+
+#include <stdint.h>
+
+#include "elect.h"
+
+/**
+ * @brief Number of fractional bits, and 1 in fixed point
+ */
+#define AGGR_FRAC       (16U)
+#define AGGR_ONE        ((int64_t)1 << AGGR_FRAC)
+
+/* --- internal helper functions --- */
+
+static void _add(elect_aggr_t *aggr, int32_t sum, uint16_t count)
+{
+    if (ELECT_AGGR_MODE == ELECT_AGGR_EWMA) {
+        // sum is a single value here
+        aggr->sum += (sum * AGGR_ONE - aggr->sum) >> ELECT_WEIGHT_SHIFT;
+    }
+    else {
+        aggr->sum += sum * AGGR_ONE;
+        aggr->weight += count * AGGR_ONE;
+    }
+}
+
+/* --- public interface functions --- */
+
+void aggr_init(elect_aggr_t *aggr, int16_t value)
+{
+    aggr->sum = value * AGGR_ONE;
+    aggr->weight = AGGR_ONE;
+    aggr->own = value;
+}
+
+void aggr_round(elect_aggr_t *aggr, int16_t value)
+{
+    if (ELECT_AGGR_MODE == ELECT_AGGR_LAST) {
+        // replace own value, members keep theirs
+        aggr->sum += (value - aggr->own) * AGGR_ONE;
+        aggr->own = value;
+        return;
+    }
+    if (ELECT_AGGR_MODE == ELECT_AGGR_MEAN) {
+        aggr_init(aggr, value);
+        return;
+    }
+    if (ELECT_AGGR_MODE == ELECT_AGGR_DECAY) {
+        aggr->sum -= aggr->sum >> ELECT_DECAY_SHIFT;
+        aggr->weight -= aggr->weight >> ELECT_DECAY_SHIFT;
+    }
+    _add(aggr, value, 1);
+}
+
+void aggr_add(elect_aggr_t *aggr, elect_member_t *member,
+              const elect_sample_t *sample)
+{
+    if (ELECT_AGGR_MODE == ELECT_AGGR_LAST) {
+        if ((member->count > 0) &&
+            ((int16_t)(sample->seq - member->seq) <= 0) &&
+            ((int32_t)(sample->time - member->time) <= 0)) {
+            // duplicate or reordered response, keep cached sample
+            return;
+        }
+        aggr_drop(aggr, member);
+        member->sum = sample->count ? sample->sum : sample->value;
+        member->count = sample->count ? sample->count : 1;
+        member->seq = sample->seq;
+        member->time = sample->time;
+        _add(aggr, member->sum, member->count);
+        return;
+    }
+    if ((ELECT_AGGR_MODE == ELECT_AGGR_EWMA) || (sample->count == 0)) {
+        _add(aggr, sample->value, 1);
+    }
+    else {
+        _add(aggr, sample->sum, sample->count);
+    }
+}
+
+void aggr_drop(elect_aggr_t *aggr, elect_member_t *member)
+{
+    if ((ELECT_AGGR_MODE == ELECT_AGGR_LAST) && (member->count > 0)) {
+        aggr->sum -= member->sum * AGGR_ONE;
+        aggr->weight -= member->count * AGGR_ONE;
+        member->count = 0;
+    }
+}
+
+int16_t aggr_value(const elect_aggr_t *aggr)
+{
+    if (ELECT_AGGR_MODE == ELECT_AGGR_EWMA) {
+        return (int16_t)((aggr->sum + AGGR_ONE / 2) >> AGGR_FRAC);
+    }
+    if (aggr->weight <= 0) {
+        return 0;
+    }
+    // round half away from zero
+    int64_t half = aggr->weight / 2;
+    int64_t sum = (aggr->sum >= 0) ? (aggr->sum + half) : (aggr->sum - half);
+    return (int16_t)(sum / aggr->weight);
+}
@@ -25,47 +25,391 @@
 
 #include "log.h"
 #include "fmt.h"
+#include "irq.h"
 #include "msg.h"
 #include "net/gcoap.h"
 #include "net/ipv6/addr.h"
+#include "random.h"
 
 #include "elect.h"
 
-#define ELECT_COAP_PORT         (5683U)
+#define ELECT_COAP_PATH_AGGREGATE ("/aggregate")
 #define ELECT_COAP_PATH_NODES   ("/nodes")
 #define ELECT_COAP_PATH_SENSOR  ("/sensor")
+#define ELECT_COAP_PATH_STANDBY ("/standby")
+#define ELECT_COAP_PATH_STATS   ("/stats")
+#define ELECT_COAP_PATH_TRACE   ("/trace")
+
+#ifndef COAP_OPT_ACCEPT
+#define COAP_OPT_ACCEPT         (17)
+#endif
+#ifndef COAP_OPT_BLOCK2
+#define COAP_OPT_BLOCK2         (23)
+#endif
+
+/**
+ * @name Fields of the value of a Block2 option, see RFC 7959
+ * @{
+ */
+#define ELECT_COAP_BLOCK_SZX    (0x07)
+#define ELECT_COAP_BLOCK_MORE   (0x08)
+#define ELECT_COAP_BLOCK_NUM    (4U)    /**< shift of the block number */
+/** @} */
+
+#ifndef ELECT_COAP_FORMAT
+/**
+ * @brief Content format used for payloads sent by this node
+ *
+ * Received payloads are decoded according to their content format, thus
+ * COAP_FORMAT_CBOR and COAP_FORMAT_TEXT are accepted either way. Responses
+ * use the format asked for by an Accept option, this one without.
+ */
+#define ELECT_COAP_FORMAT       (COAP_FORMAT_CBOR)
+#endif
 
 static void _resp_handler(unsigned req_state, coap_pkt_t* pdu, sock_udp_ep_t *remote);
+static void _sensor_resp_handler(unsigned req_state, coap_pkt_t* pdu, sock_udp_ep_t *remote);
+static void _nodes_resp_handler(unsigned req_state, coap_pkt_t* pdu, sock_udp_ep_t *remote);
+static void _list_resp_handler(unsigned req_state, coap_pkt_t* pdu, sock_udp_ep_t *remote);
+static ssize_t _aggregate_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len);
 static ssize_t _nodes_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len);
 static ssize_t _sensor_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len);
+static ssize_t _standby_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len);
+static ssize_t _stats_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len);
+#if ELECT_TRACE_NUM
+static ssize_t _trace_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len);
+#endif
+
+/**
+ * @brief Index of each CoAP resource, in the order of their paths
+ */
+enum {
+    COAP_RES_AGGREGATE,
+    COAP_RES_NODES,
+    COAP_RES_SENSOR,
+    COAP_RES_STANDBY,
+    COAP_RES_STATS,
+#if ELECT_TRACE_NUM
+    COAP_RES_TRACE,
+#endif
+    COAP_RES_NUMOF
+};
 
-/* CoAP resources */
-static const coap_resource_t _resources[] = {
-    { ELECT_COAP_PATH_NODES,  COAP_PUT,  _nodes_handler },
-    { ELECT_COAP_PATH_SENSOR, COAP_GET,  _sensor_handler },
+/* CoAP resources, gcoap expects them sorted by path */
+static const coap_resource_t _resources[COAP_RES_NUMOF] = {
+    [COAP_RES_AGGREGATE] =
+        { ELECT_COAP_PATH_AGGREGATE, COAP_GET, _aggregate_handler },
+    [COAP_RES_NODES] =
+        { ELECT_COAP_PATH_NODES, COAP_GET | COAP_PUT, _nodes_handler },
+    [COAP_RES_SENSOR] =
+        { ELECT_COAP_PATH_SENSOR, COAP_GET, _sensor_handler },
+    [COAP_RES_STANDBY] =
+        { ELECT_COAP_PATH_STANDBY, COAP_PUT, _standby_handler },
+    [COAP_RES_STATS] =
+        { ELECT_COAP_PATH_STATS, COAP_GET, _stats_handler },
+#if ELECT_TRACE_NUM
+    [COAP_RES_TRACE] =
+        { ELECT_COAP_PATH_TRACE, COAP_GET, _trace_handler },
+#endif
 };
+static const coap_resource_t *_sensor_resource = &_resources[COAP_RES_SENSOR];
 
 static gcoap_listener_t _listener = {
     (coap_resource_t *)&_resources[0],
-    sizeof(_resources) / sizeof(_resources[0]),
+    COAP_RES_NUMOF,
     NULL
 };
 
 static kernel_pid_t main_pid;
+/* sequence number of the last sensor sample sent */
+static uint16_t sensor_seq;
+/* token of the latest group request, to match responses against */
+static uint8_t group_token[GCOAP_TOKENLEN];
+/* send time of the latest group request in us */
+static uint32_t group_sent;
+/* tokens and send times in us of unicast sensor requests, for their RTT */
+static struct {
+    uint8_t token[GCOAP_TOKENLEN];
+    uint32_t sent;
+} req_sent[GCOAP_REQ_WAITING_MAX];
+static unsigned req_next;
+/* requests are built by main only, gcoap copies them when sending */
+static uint8_t req_buf[ELECT_COAP_BUF_SIZE];
+/* token used for observe registrations, to match notifications against */
+static uint8_t obs_token[GCOAP_TOKENLEN];
+/* last sample sent as notification to an observer, and the content format
+ * the observer accepts, set by gcoap on registration and by main */
+static elect_sample_t obs_last;
+static unsigned obs_format = ELECT_COAP_FORMAT;
+/* partial aggregate of a group head, set by main */
+static int32_t part_sum;
+static uint16_t part_count;
+/* group request whose response waits for its Leisure, set by gcoap */
+static struct {
+    uint8_t token[GCOAP_TOKENLEN];
+    unsigned format;
+    bool pending;
+} leisure;
+static xtimer_t leisure_timer;
+static msg_t leisure_msg = { .type = ELECT_LEISURE_EVENT };
+/* latest aggregate of the coordinator and when it was set in ms, set by main */
+static elect_aggregate_t aggr_last;
+static uint32_t aggr_time;
+static bool aggr_known;
+
+/**
+ * @brief Get space left for payload in PDU buffer
+ */
+static inline size_t _payload_space(const coap_pkt_t *pdu, const uint8_t *buf,
+                                    size_t len)
+{
+    return len - (size_t)(pdu->payload - buf);
+}
+
+/**
+ * @brief Parse sensor sample from payload, either CBOR or text encoded
+ *
+ * @returns 0 on success, error otherwise
+ */
+static int _parse_sample(coap_pkt_t *pdu, elect_sample_t *sample)
+{
+    if (pdu->content_type == COAP_FORMAT_CBOR) {
+        return codec_get_sample(pdu->payload, pdu->payload_len, sample);
+    }
+    else if (pdu->content_type == COAP_FORMAT_TEXT) {
+        char str[ELECT_BC_SENSOR_LEN];
+        if (pdu->payload_len >= sizeof(str)) {
+            return 1;
+        }
+        memcpy(str, pdu->payload, pdu->payload_len);
+        str[pdu->payload_len] = '\0';
+        sample->value = (int16_t)strtol(str, NULL, 10);
+        sample->time  = xtimer_now_usec() / US_PER_MS;
+        sample->seq   = 0;
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Parse node IP address from payload, either CBOR or text encoded
+ *
+ * @returns 0 on success, error otherwise
+ */
+static int _parse_node(coap_pkt_t *pdu, ipv6_addr_t *addr)
+{
+    if (pdu->content_type == COAP_FORMAT_CBOR) {
+        return codec_get_node(pdu->payload, pdu->payload_len, addr);
+    }
+    else if (pdu->content_type == COAP_FORMAT_TEXT) {
+        char str[IPV6_ADDR_MAX_STR_LEN];
+        if ((pdu->payload_len <= 6) || (pdu->payload_len >= sizeof(str))) {
+            return 1;
+        }
+        memcpy(str, pdu->payload, pdu->payload_len);
+        str[pdu->payload_len] = '\0';
+        return (ipv6_addr_from_str(addr, str) == NULL) ? 1 : 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Parse registration from payload, either CBOR or text encoded
+ *
+ * @returns 0 on success, error otherwise
+ */
+static int _parse_reg(coap_pkt_t *pdu, elect_reg_t *reg)
+{
+    if (pdu->content_type == COAP_FORMAT_CBOR) {
+        return codec_get_reg(pdu->payload, pdu->payload_len, reg);
+    }
+    /* text carries the address only */
+    reg->members = 0;
+    reg->renew = false;
+    reg->epoch = 0;
+    return _parse_node(pdu, &reg->node);
+}
+
+/**
+ * @brief Get end of received @p pdu, in @p buf of @p len
+ *
+ * The buffer gcoap passes is larger than the message, bytes after it may be
+ * left from an earlier one. nanocoap points the payload at the end of the
+ * options it parsed, its length ends the message. A payload outside of the
+ * buffer is taken for a message without options.
+ */
+static inline const uint8_t *_options_end(coap_pkt_t *pdu,
+                                          const uint8_t *buf, size_t len)
+{
+    const uint8_t *start = &pdu->hdr->data[coap_get_token_len(pdu)];
+    if ((pdu->payload < start) || (pdu->payload > &buf[len]) ||
+        (pdu->payload_len > (size_t)(&buf[len] - pdu->payload))) {
+        return start;
+    }
+    return pdu->payload + pdu->payload_len;
+}
+
+/**
+ * @brief Get value of the uint option @p num of @p pdu
+ *
+ * nanocoap does not parse Accept and Block2, thus the options are walked
+ * up to the payload marker or @p end, see _options_end(). Options beyond
+ * Block2 are not looked for.
+ *
+ * @returns 0 on success, error if there is none
+ */
+static int _get_option(coap_pkt_t *pdu, const uint8_t *end, unsigned num,
+                       uint32_t *val)
+{
+    const uint8_t *pos = &pdu->hdr->data[coap_get_token_len(pdu)];
+    unsigned onum = 0;
+    while ((pos < end) && (*pos != 0xff)) {
+        unsigned delta = *pos >> 4;
+        unsigned olen = *pos++ & 0x0f;
+        /* extended delta and length, of 1 or 2 bytes */
+        unsigned *field[] = { &delta, &olen };
+        for (unsigned i = 0; i < 2; i++) {
+            if (*field[i] == 13) {
+                if ((pos + 1) > end) {
+                    return 1;
+                }
+                *field[i] = 13 + *pos++;
+            }
+            else if (*field[i] == 14) {
+                if ((pos + 2) > end) {
+                    return 1;
+                }
+                *field[i] = 269 + ((pos[0] << 8) | pos[1]);
+                pos += 2;
+            }
+            else if (*field[i] == 15) {
+                return 1;
+            }
+        }
+        onum += delta;
+        if ((onum > num) || ((pos + olen) > end)) {
+            break;
+        }
+        if (onum == num) {
+            if (olen > 3) {
+                return 1;
+            }
+            *val = 0;
+            for (unsigned i = 0; i < olen; i++) {
+                *val = (*val << 8) | pos[i];
+            }
+            return 0;
+        }
+        pos += olen;
+    }
+    return 1;
+}
+
+/**
+ * @brief Get value of the Block2 option of @p pdu, see _get_option()
+ */
+static inline int _get_block2(coap_pkt_t *pdu, const uint8_t *end,
+                              uint32_t *val)
+{
+    return _get_option(pdu, end, COAP_OPT_BLOCK2, val);
+}
+
+/**
+ * @brief Get content format to respond to request @p pdu with
+ *
+ * Has to be called before the response is written to @p buf.
+ *
+ * @returns COAP_FORMAT_CBOR or COAP_FORMAT_TEXT, COAP_FORMAT_NONE if the
+ *          request accepts neither
+ */
+static unsigned _accept(coap_pkt_t *pdu, uint8_t *buf, size_t len)
+{
+    uint32_t accept;
+    if (_get_option(pdu, _options_end(pdu, buf, len), COAP_OPT_ACCEPT,
+                    &accept) != 0) {
+        return ELECT_COAP_FORMAT;
+    }
+    if ((accept == COAP_FORMAT_CBOR) || (accept == COAP_FORMAT_TEXT)) {
+        return accept;
+    }
+    return COAP_FORMAT_NONE;
+}
+
+/**
+ * @brief Write Block2 option, as only or following option @p lastonum
+ *
+ * @returns length of option
+ */
+static size_t _put_block2(uint8_t *buf, uint16_t lastonum, uint32_t val)
+{
+    uint8_t opt[3];
+    size_t olen = (val > 0xffff) ? 3 : (val > 0xff) ? 2 : (val > 0) ? 1 : 0;
+    for (size_t i = 0; i < olen; i++) {
+        opt[i] = (uint8_t)(val >> (8 * (olen - 1 - i)));
+    }
+    return coap_put_option(buf, lastonum, COAP_OPT_BLOCK2, opt, olen);
+}
+
+/**
+ * @brief Get round trip time of the unicast sensor request @p pdu responds to
+ *
+ * @returns round trip time in us, 0 if the request is unknown
+ */
+static uint32_t _rtt(coap_pkt_t *pdu)
+{
+    uint32_t now = xtimer_now_usec();
+    uint32_t rtt = 0;
+    if (coap_get_token_len(pdu) != GCOAP_TOKENLEN) {
+        return 0;
+    }
+    unsigned state = irq_disable();
+    for (unsigned i = 0; i < GCOAP_REQ_WAITING_MAX; i++) {
+        if ((req_sent[i].sent != 0) &&
+            (memcmp(req_sent[i].token, pdu->token, GCOAP_TOKENLEN) == 0)) {
+            rtt = now - req_sent[i].sent;
+            req_sent[i].sent = 0;
+            break;
+        }
+    }
+    irq_restore(state);
+    return rtt;
+}
+
+/**
+ * @brief Write IP address of node as payload of given PDU, in @p format
+ *
+ * @returns length of payload
+ */
+static size_t _put_node(coap_pkt_t *pdu, uint8_t *buf, size_t len,
+                        unsigned format, const ipv6_addr_t *addr)
+{
+    size_t space = _payload_space(pdu, buf, len);
+    if (format == COAP_FORMAT_CBOR) {
+        return codec_put_node(pdu->payload, space, addr);
+    }
+    if ((space < IPV6_ADDR_MAX_STR_LEN) ||
+        (ipv6_addr_to_str((char *)pdu->payload, addr, space) == NULL)) {
+        return 0;
+    }
+    return strlen((char *)pdu->payload) + 1;
+}
 
 static void _resp_handler(unsigned req_state, coap_pkt_t* pdu,
                           sock_udp_ep_t *remote)
 {
     LOG_DEBUG("%s: begin\n", __func__);
-    (void)remote;
     msg_t sensor_msg = { .type = ELECT_SENSOR_EVENT };
 
+    ELECT_TRACE(ELECT_TRACE_COAP_RESP, req_state,
+                (req_state == GCOAP_MEMO_RESP) ? coap_get_code_raw(pdu) : 0);
     if (req_state == GCOAP_MEMO_TIMEOUT) {
         LOG_ERROR("gcoap: timeout for msg ID %02u\n", coap_get_id(pdu));
+        stats_inc(ELECT_STATS_COAP_TIMEOUT);
         return;
     }
     else if (req_state == GCOAP_MEMO_ERR) {
         LOG_ERROR("gcoap: error in response\n");
+        stats_inc(ELECT_STATS_COAP_ERROR);
         return;
     }
 
@@ -75,9 +419,20 @@ static void _resp_handler(unsigned req_state, coap_pkt_t* pdu,
                                                 coap_get_code_class(pdu),
                                                 coap_get_code_detail(pdu));
     if (pdu->payload_len) {
-        if (pdu->content_type == COAP_FORMAT_TEXT) {
-            sensor_msg.content.ptr = pdu->payload;
-            msg_send_receive(&sensor_msg, &sensor_msg, main_pid);
+        if ((coap_get_code_class(pdu) == COAP_CLASS_SUCCESS) &&
+            ((pdu->content_type == COAP_FORMAT_CBOR) ||
+             (pdu->content_type == COAP_FORMAT_TEXT))) {
+            elect_sample_t sample;
+            if (_parse_sample(pdu, &sample) == 0) {
+                memcpy(&sample.addr, &remote->addr.ipv6[0],
+                       sizeof(sample.addr));
+                sample.rtt = _rtt(pdu);
+                sensor_msg.content.ptr = &sample;
+                msg_send_receive(&sensor_msg, &sensor_msg, main_pid);
+            }
+            else {
+                LOG_WARNING("gcoap: invalid sensor payload\n");
+            }
         }
         else if ((pdu->content_type == COAP_FORMAT_LINK) ||
                  (coap_get_code_class(pdu) == COAP_CLASS_CLIENT_FAILURE) ||
@@ -93,44 +448,435 @@ static void _resp_handler(unsigned req_state, coap_pkt_t* pdu,
     LOG_DEBUG("%s: done\n", __func__);
 }
 
+static void _nodes_resp_handler(unsigned req_state, coap_pkt_t* pdu,
+                                sock_udp_ep_t *remote)
+{
+    LOG_DEBUG("%s: begin\n", __func__);
+    msg_t parent_msg = { .type = ELECT_PARENT_EVENT };
+    msg_t reg_msg = { .type = ELECT_REGISTERED_EVENT };
+    ipv6_addr_t parent;
+    ipv6_addr_t registrar;
+
+    ELECT_TRACE(ELECT_TRACE_COAP_RESP, req_state,
+                (req_state == GCOAP_MEMO_RESP) ? coap_get_code_raw(pdu) : 0);
+    if (req_state == GCOAP_MEMO_TIMEOUT) {
+        LOG_ERROR("gcoap: timeout for msg ID %02u\n", coap_get_id(pdu));
+        stats_inc(ELECT_STATS_COAP_TIMEOUT);
+        return;
+    }
+    else if ((req_state == GCOAP_MEMO_ERR) ||
+             (coap_get_code_class(pdu) != COAP_CLASS_SUCCESS)) {
+        LOG_ERROR("gcoap: error in response\n");
+        stats_inc(ELECT_STATS_COAP_ERROR);
+        return;
+    }
+    /* a payload redirects the registration to the head of our group */
+    if (pdu->payload_len && (_parse_node(pdu, &parent) == 0)) {
+        parent_msg.content.ptr = &parent;
+        msg_send_receive(&parent_msg, &parent_msg, main_pid);
+    }
+    else {
+        memcpy(&registrar, &remote->addr.ipv6[0], sizeof(registrar));
+        reg_msg.content.ptr = &registrar;
+        msg_send_receive(&reg_msg, &reg_msg, main_pid);
+    }
+    LOG_DEBUG("%s: done\n", __func__);
+}
+
+static void _list_resp_handler(unsigned req_state, coap_pkt_t* pdu,
+                               sock_udp_ep_t *remote)
+{
+    LOG_DEBUG("%s: begin\n", __func__);
+    msg_t seed_msg = { .type = ELECT_SEED_EVENT };
+    elect_block_t blk = { .num = 0, .more = false, .lost = false };
+    uint32_t block2;
+
+    ELECT_TRACE(ELECT_TRACE_COAP_RESP, req_state,
+                (req_state == GCOAP_MEMO_RESP) ? coap_get_code_raw(pdu) : 0);
+    if (req_state == GCOAP_MEMO_TIMEOUT) {
+        LOG_ERROR("gcoap: timeout for msg ID %02u\n", coap_get_id(pdu));
+        stats_inc(ELECT_STATS_COAP_TIMEOUT);
+        /* main asks for the block again, the remote is not known here */
+        blk.lost = true;
+        seed_msg.content.ptr = &blk;
+        msg_send_receive(&seed_msg, &seed_msg, main_pid);
+        return;
+    }
+    else if ((req_state == GCOAP_MEMO_ERR) ||
+             (coap_get_code_class(pdu) != COAP_CLASS_SUCCESS)) {
+        LOG_ERROR("gcoap: error in response\n");
+        stats_inc(ELECT_STATS_COAP_ERROR);
+        return;
+    }
+    /* an empty table is sent without payload, and without block option */
+    if (pdu->payload_len) {
+        if ((_get_block2(pdu, pdu->payload, &block2) != 0) ||
+            (pdu->payload_len % ELECT_FRAME_IID_LEN) ||
+            ((pdu->payload_len / ELECT_FRAME_IID_LEN) > ELECT_NODES_BLOCK)) {
+            LOG_WARNING("gcoap: invalid block of members\n");
+            return;
+        }
+        blk.first = ((block2 >> ELECT_COAP_BLOCK_NUM) <<
+                     ((block2 & ELECT_COAP_BLOCK_SZX) + 4)) /
+                    ELECT_FRAME_IID_LEN;
+        blk.more = (block2 & ELECT_COAP_BLOCK_MORE) != 0;
+        blk.num = pdu->payload_len / ELECT_FRAME_IID_LEN;
+        for (unsigned i = 0; i < blk.num; i++) {
+            ipv6_addr_t *node = &blk.nodes[i];
+            memset(node, 0, sizeof(*node));
+            ipv6_addr_set_link_local_prefix(node);
+            memcpy(&node->u8[ELECT_FRAME_IID_LEN],
+                   &pdu->payload[i * ELECT_FRAME_IID_LEN], ELECT_FRAME_IID_LEN);
+        }
+    }
+    memcpy(&blk.node, &remote->addr.ipv6[0], sizeof(blk.node));
+    seed_msg.content.ptr = &blk;
+    msg_send_receive(&seed_msg, &seed_msg, main_pid);
+    LOG_DEBUG("%s: done\n", __func__);
+}
+
+static void _sensor_resp_handler(unsigned req_state, coap_pkt_t* pdu,
+                                 sock_udp_ep_t *remote)
+{
+    _resp_handler(req_state, pdu, remote);
+    /* let the poll scheduler reuse the slot of this request */
+    msg_t done_msg = { .type = ELECT_POLL_DONE_EVENT };
+    msg_send_receive(&done_msg, &done_msg, main_pid);
+}
+
+/**
+ * @brief Respond with a block of the membership table
+ *
+ * The table is a sequence of interface IDs, blocks are at most as large
+ * as 2^(ELECT_NODES_BLOCK_SZX + 4) bytes. Entries may move between blocks,
+ * as members join and leave in between, nodes read the blocks fast enough
+ * for this to be rare. gcoap adds no options besides the content format,
+ * thus the response is built manually.
+ */
+static ssize_t _nodes_get(coap_pkt_t *pdu, uint8_t *buf, size_t len)
+{
+    msg_t list_msg = { .type = ELECT_LIST_EVENT };
+    elect_block_t blk = { .first = 0, .num = ELECT_NODES_BLOCK };
+    uint8_t token[8];
+    unsigned tkl = coap_get_token_len(pdu);
+    unsigned type = (coap_get_type(pdu) == COAP_TYPE_CON) ? COAP_TYPE_ACK
+                                                          : COAP_TYPE_NON;
+    unsigned szx = ELECT_NODES_BLOCK_SZX;
+    uint32_t block2;
+
+    if (_get_block2(pdu, _options_end(pdu, buf, len), &block2) == 0) {
+        /* a smaller size asked for is used, a larger one is not */
+        if ((block2 & ELECT_COAP_BLOCK_SZX) < szx) {
+            szx = block2 & ELECT_COAP_BLOCK_SZX;
+        }
+        blk.first = ((block2 >> ELECT_COAP_BLOCK_NUM) <<
+                     ((block2 & ELECT_COAP_BLOCK_SZX) + 4)) /
+                    ELECT_FRAME_IID_LEN;
+        blk.num = (16U << szx) / ELECT_FRAME_IID_LEN;
+    }
+    if (tkl > sizeof(token)) {
+        return gcoap_response(pdu, buf, len, COAP_CODE_BAD_REQUEST);
+    }
+    memcpy(token, pdu->token, tkl);
+    list_msg.content.ptr = &blk;
+    msg_send_receive(&list_msg, &list_msg, main_pid);
+
+    /* header, token, content format, Block2, payload marker, and IDs */
+    if (len < (4 + tkl + 3 + 4 + 1 + blk.num * ELECT_FRAME_IID_LEN)) {
+        LOG_WARNING("%s: block exceeds PDU buffer!\n", __func__);
+        return gcoap_response(pdu, buf, len, COAP_CODE_INTERNAL_SERVER_ERROR);
+    }
+    uint8_t *pos = &buf[0];
+    pos += coap_build_hdr((coap_hdr_t *)pos, type, token, tkl,
+                          COAP_CODE_CONTENT, coap_get_id(pdu));
+    if (blk.num == 0) {
+        return (ssize_t)(pos - buf);
+    }
+    pos += coap_put_option_ct(pos, 0, COAP_FORMAT_OCTET);
+    pos += _put_block2(pos, COAP_OPT_CONTENT_FORMAT,
+                       (((blk.first * ELECT_FRAME_IID_LEN) >> (szx + 4))
+                        << ELECT_COAP_BLOCK_NUM) |
+                       (blk.more ? ELECT_COAP_BLOCK_MORE : 0) | szx);
+    *pos++ = 0xff;
+    for (unsigned i = 0; i < blk.num; i++) {
+        memcpy(pos, &blk.nodes[i].u8[ELECT_FRAME_IID_LEN], ELECT_FRAME_IID_LEN);
+        pos += ELECT_FRAME_IID_LEN;
+    }
+    return (ssize_t)(pos - buf);
+}
+
 static ssize_t _nodes_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len)
 {
     LOG_DEBUG("%s: begin (buflen=%u)\n", __func__, (unsigned)len);
     /* read coap method type in packet */
     unsigned method_flag = coap_method2flag(coap_get_code_detail(pdu));
     msg_t nodes_msg = { .type = ELECT_NODES_EVENT };
-    //ipv6_addr_t addr;
+    elect_reg_t reg;
+    unsigned format = _accept(pdu, buf, len);
     switch(method_flag) {
         case COAP_PUT:
-            LOG_DEBUG("%s: received put with payload: %s\n", __func__, (char *)pdu->payload);
-            if (pdu->payload_len > 6) {
-                nodes_msg.content.ptr = pdu->payload;
+            LOG_DEBUG("%s: received put with %u byte(s)\n", __func__,
+                      pdu->payload_len);
+            if (_parse_reg(pdu, &reg) == 0) {
+                ipv6_addr_set_unspecified(&reg.parent);
+                reg.accepted = false;
+                nodes_msg.content.ptr = &reg;
                 msg_send_receive(&nodes_msg, &nodes_msg, main_pid);
-                return gcoap_response(pdu, buf, len, COAP_CODE_CHANGED);
+                if (!reg.accepted) {
+                    /* not coordinator (yet), the node tries again */
+                    return gcoap_response(pdu, buf, len,
+                                          COAP_CODE_SERVICE_UNAVAILABLE);
+                }
+                if (ipv6_addr_is_unspecified(&reg.parent)) {
+                    return gcoap_response(pdu, buf, len, COAP_CODE_CHANGED);
+                }
+                /* node has to register with the head of its group */
+                if (format == COAP_FORMAT_NONE) {
+                    return gcoap_response(pdu, buf, len,
+                                          COAP_CODE_NOT_ACCEPTABLE);
+                }
+                gcoap_resp_init(pdu, buf, len, COAP_CODE_CHANGED);
+                size_t plen = _put_node(pdu, buf, len, format, &reg.parent);
+                return gcoap_finish(pdu, plen, format);
             }
             else {
                 return gcoap_response(pdu, buf, len, COAP_CODE_BAD_REQUEST);
             }
+        case COAP_GET:
+            return _nodes_get(pdu, buf, len);
     }
     LOG_DEBUG("%s: done\n", __func__);
     return 0;
 }
 
+/**
+ * @brief Write sensor sample as payload of given PDU, in @p format
+ *
+ * @returns length of payload
+ */
+static size_t _put_sample(coap_pkt_t *pdu, uint8_t *buf, size_t len,
+                          unsigned format, const elect_sample_t *sample)
+{
+    size_t plen;
+    if (format == COAP_FORMAT_CBOR) {
+        plen = codec_put_sample(pdu->payload, _payload_space(pdu, buf, len),
+                                sample);
+    }
+    else {
+        plen = fmt_s16_dec((char *)pdu->payload, sample->value);
+        pdu->payload[plen++] = '\0';
+    }
+    return plen;
+}
+
+/**
+ * @brief Take the current sensor sample, or the partial aggregate of a
+ *        group head
+ */
+static void _read_sample(elect_sample_t *sample)
+{
+    memset(sample, 0, sizeof(*sample));
+    sample->time = xtimer_now_usec() / US_PER_MS;
+    sample->seq = sensor_seq++;
+    sample->value = sensor_read();
+    unsigned state = irq_disable();
+    sample->sum = part_sum;
+    sample->count = part_count;
+    irq_restore(state);
+    if (sample->count) {
+        /* group heads respond with the aggregate of their group */
+        sample->value = (int16_t)(sample->sum / sample->count);
+    }
+}
+
+/**
+ * @brief Check if the response to @p pdu waits for a Leisure, which group
+ *        requests of the coordinator do
+ *
+ * Requests to the group are non-confirmable, unicast requests of clients
+ * and tools are usually confirmable.
+ */
+static inline bool _is_group_req(coap_pkt_t *pdu)
+{
+    return (ELECT_COAP_LEISURE > 0) && (ELECT_POLL_MODE == ELECT_POLL_GROUP) &&
+           (coap_get_type(pdu) == COAP_TYPE_NON) && !coap_has_observe(pdu) &&
+           (coap_get_token_len(pdu) == GCOAP_TOKENLEN);
+}
+
+/**
+ * @brief Defer the response to a group request by a random Leisure
+ */
+static void _defer(coap_pkt_t *pdu, unsigned format)
+{
+    elect_aggregate_t aggr;
+    uint32_t age;
+    uint32_t interval = ELECT_MSG_INTERVAL;
+    if (coap_read_aggregate(&aggr, &age) == 0) {
+        interval = aggr.interval;
+    }
+    uint32_t max = interval * ELECT_COAP_LEISURE / 100U * US_PER_MS;
+    unsigned state = irq_disable();
+    memcpy(leisure.token, pdu->token, GCOAP_TOKENLEN);
+    leisure.format = format;
+    leisure.pending = true;
+    irq_restore(state);
+    /* a response still waiting belongs to an older round, it is replaced */
+    xtimer_set_msg(&leisure_timer, random_uint32_range(0, max + 1),
+                   &leisure_msg, main_pid);
+}
+
 static ssize_t _sensor_handler(coap_pkt_t *pdu, uint8_t *buf, size_t len)
 {
     LOG_DEBUG("%s: begin (buflen=%u)\n", __func__, (unsigned)len);
     msg_t leader_msg = { .type = ELECT_LEADER_ALIVE_EVENT };
+    unsigned format = _accept(pdu, buf, len);
+    if (format == COAP_FORMAT_NONE) {
+        return gcoap_response(pdu, buf, len, COAP_CODE_NOT_ACCEPTABLE);
+    }
+    if (_is_group_req(pdu)) {
+        _defer(pdu, format);
+        msg_send_receive(&leader_msg, &leader_msg, main_pid);
+        LOG_DEBUG("%s: deferred\n", __func__);
+        /* gcoap sends no response for a length of 0 */
+        return 0;
+    }
     gcoap_resp_init(pdu, buf, len, COAP_CODE_CONTENT);
-    /* write the RIOT board name in the response buffer */
-    int16_t val = sensor_read();
-    size_t plen = fmt_s16_dec((char *)pdu->payload, val);
-    pdu->payload[plen++] = '\0';
+    /* write the current sensor sample in the response buffer */
+    elect_sample_t sample;
+    _read_sample(&sample);
+    size_t plen = _put_sample(pdu, buf, len, format, &sample);
+    ELECT_TRACE(ELECT_TRACE_SENSOR_REQ, sample.value, sample.seq);
+    stats_inc(ELECT_STATS_SENSOR_TX);
+    if (coap_has_observe(pdu)) {
+        /* registration of an observer, notifications continue from here */
+        unsigned state = irq_disable();
+        obs_last = sample;
+        obs_format = format;
+        irq_restore(state);
+    }
     msg_send_receive(&leader_msg, &leader_msg, main_pid);
     LOG_DEBUG("%s: done\n", __func__);
-    return gcoap_finish(pdu, plen, COAP_FORMAT_TEXT);;
+    return gcoap_finish(pdu, plen, format);
+}
+
+static ssize_t _standby_handler(coap_pkt_t *pdu, uint8_t *buf, size_t len)
+{
+    LOG_DEBUG("%s: begin (buflen=%u)\n", __func__, (unsigned)len);
+    msg_t sync_msg = { .type = ELECT_SYNC_EVENT };
+    elect_sync_t sync = { .num = ELECT_STANDBY_CHUNK };
+    if ((pdu->content_type != COAP_FORMAT_CBOR) ||
+        (codec_get_nodes(pdu->payload, pdu->payload_len, sync.nodes,
+                         &sync.num) != 0)) {
+        return gcoap_response(pdu, buf, len, COAP_CODE_BAD_REQUEST);
+    }
+    sync_msg.content.ptr = &sync;
+    msg_send_receive(&sync_msg, &sync_msg, main_pid);
+    LOG_DEBUG("%s: done\n", __func__);
+    return gcoap_response(pdu, buf, len, COAP_CODE_CHANGED);
+}
+
+static ssize_t _aggregate_handler(coap_pkt_t *pdu, uint8_t *buf, size_t len)
+{
+    LOG_DEBUG("%s: begin (buflen=%u)\n", __func__, (unsigned)len);
+    elect_aggregate_t aggr;
+    uint32_t age;
+    unsigned format = _accept(pdu, buf, len);
+    if (format == COAP_FORMAT_NONE) {
+        return gcoap_response(pdu, buf, len, COAP_CODE_NOT_ACCEPTABLE);
+    }
+    if (coap_read_aggregate(&aggr, &age) != 0) {
+        return gcoap_response(pdu, buf, len, COAP_CODE_SERVICE_UNAVAILABLE);
+    }
+    gcoap_resp_init(pdu, buf, len, COAP_CODE_CONTENT);
+    size_t plen;
+    if (format == COAP_FORMAT_CBOR) {
+        plen = codec_put_aggregate(pdu->payload, _payload_space(pdu, buf, len),
+                                   &aggr, age);
+    }
+    else {
+        plen = fmt_s16_dec((char *)pdu->payload, aggr.value);
+        pdu->payload[plen++] = '\0';
+    }
+    LOG_DEBUG("%s: done\n", __func__);
+    return gcoap_finish(pdu, plen, format);
+}
+
+/**
+ * @brief Respond with a block of the statistics
+ *
+ * The statistics exceed a PDU, thus they are sent in blocks of at most
+ * 2^(ELECT_STATS_BLOCK_SZX + 4) bytes, small enough for the default
+ * GCOAP_PDU_BUF_SIZE. See _nodes_get() for why the response is built
+ * manually.
+ */
+static ssize_t _stats_handler(coap_pkt_t *pdu, uint8_t *buf, size_t len)
+{
+    LOG_DEBUG("%s: begin (buflen=%u)\n", __func__, (unsigned)len);
+    const uint8_t *end = _options_end(pdu, buf, len);
+    uint8_t token[8];
+    unsigned tkl = coap_get_token_len(pdu);
+    unsigned type = (coap_get_type(pdu) == COAP_TYPE_CON) ? COAP_TYPE_ACK
+                                                          : COAP_TYPE_NON;
+    unsigned szx = ELECT_STATS_BLOCK_SZX;
+    size_t offset = 0;
+    uint32_t val;
+
+    /* statistics are available as CBOR only */
+    if ((_get_option(pdu, end, COAP_OPT_ACCEPT, &val) == 0) &&
+        (val != COAP_FORMAT_CBOR)) {
+        return gcoap_response(pdu, buf, len, COAP_CODE_NOT_ACCEPTABLE);
+    }
+    if (_get_block2(pdu, end, &val) == 0) {
+        /* a smaller size asked for is used, a larger one is not */
+        if ((val & ELECT_COAP_BLOCK_SZX) < szx) {
+            szx = val & ELECT_COAP_BLOCK_SZX;
+        }
+        offset = (val >> ELECT_COAP_BLOCK_NUM) <<
+                 ((val & ELECT_COAP_BLOCK_SZX) + 4);
+    }
+    size_t total = stats_dump(NULL, 0, 0);
+    if ((tkl > sizeof(token)) || (offset >= total)) {
+        return gcoap_response(pdu, buf, len, COAP_CODE_BAD_REQUEST);
+    }
+    memcpy(token, pdu->token, tkl);
+
+    size_t plen = total - offset;
+    if (plen > (16U << szx)) {
+        plen = 16U << szx;
+    }
+    /* header, token, content format, Block2, payload marker, and block */
+    if (len < (4 + tkl + 3 + 4 + 1 + plen)) {
+        LOG_WARNING("%s: block exceeds PDU buffer!\n", __func__);
+        return gcoap_response(pdu, buf, len, COAP_CODE_INTERNAL_SERVER_ERROR);
+    }
+    uint8_t *pos = &buf[0];
+    pos += coap_build_hdr((coap_hdr_t *)pos, type, token, tkl,
+                          COAP_CODE_CONTENT, coap_get_id(pdu));
+    pos += coap_put_option_ct(pos, 0, COAP_FORMAT_CBOR);
+    pos += _put_block2(pos, COAP_OPT_CONTENT_FORMAT,
+                       ((offset >> (szx + 4)) << ELECT_COAP_BLOCK_NUM) |
+                       (((offset + plen) < total) ? ELECT_COAP_BLOCK_MORE : 0) |
+                       szx);
+    *pos++ = 0xff;
+    stats_dump(pos, plen, offset);
+    pos += plen;
+    LOG_DEBUG("%s: done\n", __func__);
+    return (ssize_t)(pos - buf);
 }
 
-static size_t _send(const uint8_t *buf, size_t len, const ipv6_addr_t *addr)
+#if ELECT_TRACE_NUM
+static ssize_t _trace_handler(coap_pkt_t *pdu, uint8_t *buf, size_t len)
+{
+    LOG_DEBUG("%s: begin (buflen=%u)\n", __func__, (unsigned)len);
+    gcoap_resp_init(pdu, buf, len, COAP_CODE_CONTENT);
+    size_t plen = trace_dump(pdu->payload, _payload_space(pdu, buf, len));
+    LOG_DEBUG("%s: done\n", __func__);
+    return gcoap_finish(pdu, plen, COAP_FORMAT_OCTET);
+}
+#endif
+
+static size_t _send(const uint8_t *buf, size_t len, const ipv6_addr_t *addr,
+                    gcoap_resp_handler_t resp_handler)
 {
     LOG_DEBUG("%s: begin\n", __func__);
     sock_udp_ep_t remote;
@@ -144,31 +890,139 @@ static size_t _send(const uint8_t *buf, size_t len, const ipv6_addr_t *addr)
 
     memcpy(&remote.addr.ipv6[0], &addr->u8[0], sizeof(addr->u8));
     LOG_DEBUG("%s: done\n", __func__);
-    return gcoap_req_send2(buf, len, &remote, _resp_handler);
+    return gcoap_req_send2(buf, len, &remote, resp_handler);
 }
 
 /* --- public coap interface --- */
 
-int coap_put_node(ipv6_addr_t addr, ipv6_addr_t node)
+/**
+ * @brief Build PUT request of a registration in the request buffer
+ *
+ * @returns length of request, 0 on error
+ */
+static size_t _build_reg(const elect_reg_t *reg)
 {
-    LOG_DEBUG("%s: begin\n", __func__);
-    uint8_t buf[GCOAP_PDU_BUF_SIZE];
+    uint8_t *buf = req_buf;
     coap_pkt_t pdu;
     size_t len;
 
-    gcoap_req_init(&pdu, &buf[0], GCOAP_PDU_BUF_SIZE,
+    gcoap_req_init(&pdu, &buf[0], sizeof(req_buf),
                    COAP_METHOD_PUT, ELECT_COAP_PATH_NODES);
-    char ipbuf[IPV6_ADDR_MAX_STR_LEN];
-    if (ipv6_addr_to_str(ipbuf, &node, sizeof(ipbuf)) == NULL) {
-        LOG_ERROR("%s: ipv6_addr_to_str failed!\n", __func__);
+    if (ELECT_COAP_FORMAT == COAP_FORMAT_CBOR) {
+        len = codec_put_reg(pdu.payload,
+                            _payload_space(&pdu, &buf[0], sizeof(req_buf)),
+                            reg);
+        if (len == 0) {
+            LOG_ERROR("%s: encoding failed!\n", __func__);
+            return 0;
+        }
+    }
+    else {
+        /* text carries the address only, a re-announce registers again */
+        char ipbuf[IPV6_ADDR_MAX_STR_LEN];
+        if (ipv6_addr_to_str(ipbuf, &reg->node, sizeof(ipbuf)) == NULL) {
+            LOG_ERROR("%s: ipv6_addr_to_str failed!\n", __func__);
+            return 0;
+        }
+        len = strlen(ipbuf);
+        memcpy(pdu.payload, ipbuf, len);
+        pdu.payload[len++] = '\0';
+    }
+    if (reg->renew) {
+        coap_hdr_set_type(pdu.hdr, COAP_TYPE_NON);
+    }
+    return gcoap_finish(&pdu, len, ELECT_COAP_FORMAT);
+}
+
+int coap_put_node(ipv6_addr_t addr, ipv6_addr_t node, unsigned members)
+{
+    LOG_DEBUG("%s: begin\n", __func__);
+    elect_reg_t reg = { .node = node, .members = members };
+    size_t len = _build_reg(&reg);
+    if (len == 0) {
+        return 1;
+    }
+    stats_inc(ELECT_STATS_REG_TX);
+    if (!_send(&req_buf[0], len, &addr, _nodes_resp_handler)) {
+        LOG_ERROR("%s: send failed!\n", __func__);
+        return 2;
+    }
+    LOG_DEBUG("%s: done\n", __func__);
+    return 0;
+}
+
+int coap_announce_node(ipv6_addr_t addr, ipv6_addr_t node, unsigned members,
+                       uint16_t epoch)
+{
+    LOG_DEBUG("%s: begin\n", __func__);
+    elect_reg_t reg = {
+        .node = node, .members = members, .renew = true, .epoch = epoch,
+    };
+    size_t len = _build_reg(&reg);
+    if (len == 0) {
+        return 1;
+    }
+    stats_inc(ELECT_STATS_ANNOUNCE_TX);
+    /* no gcoap memo is used, the listener drops the response */
+    if (listen_send(&addr, ELECT_COAP_PORT, &req_buf[0], len) <= 0) {
+        LOG_ERROR("%s: send failed!\n", __func__);
+        return 2;
+    }
+    LOG_DEBUG("%s: done\n", __func__);
+    return 0;
+}
+
+int coap_get_nodes(ipv6_addr_t addr, unsigned first)
+{
+    LOG_DEBUG("%s: begin\n", __func__);
+    uint8_t *buf = req_buf;
+    uint8_t *pos = &buf[0];
+    uint32_t token = random_uint32();
+
+    /* gcoap can not add a block option to requests, build it manually */
+    ssize_t hdrlen = coap_build_hdr((coap_hdr_t *)pos, COAP_TYPE_NON,
+                                    (uint8_t *)&token, GCOAP_TOKENLEN,
+                                    COAP_METHOD_GET, (uint16_t)random_uint32());
+    if (hdrlen < 0) {
+        LOG_ERROR("%s: build header failed!\n", __func__);
         return 1;
     }
-    len = strlen(ipbuf);
-    memcpy(pdu.payload, ipbuf, len);
-    pdu.payload[len++] = '\0';
-    len = gcoap_finish(&pdu, len, COAP_FORMAT_TEXT);
+    pos += hdrlen;
+    pos += coap_put_option_uri(pos, 0, ELECT_COAP_PATH_NODES,
+                               COAP_OPT_URI_PATH);
+    pos += _put_block2(pos, COAP_OPT_URI_PATH,
+                       ((first / ELECT_NODES_BLOCK) << ELECT_COAP_BLOCK_NUM) |
+                       ELECT_NODES_BLOCK_SZX);
 
-    if (!_send(&buf[0], len, &addr)) {
+    stats_inc(ELECT_STATS_NODES_TX);
+    if (!_send(&buf[0], (size_t)(pos - buf), &addr, _list_resp_handler)) {
+        LOG_ERROR("%s: send failed!\n", __func__);
+        return 2;
+    }
+    LOG_DEBUG("%s: done\n", __func__);
+    return 0;
+}
+
+int coap_put_standby(ipv6_addr_t addr, const ipv6_addr_t *nodes, unsigned num)
+{
+    LOG_DEBUG("%s: begin\n", __func__);
+    uint8_t *buf = req_buf;
+    coap_pkt_t pdu;
+
+    gcoap_req_init(&pdu, &buf[0], sizeof(req_buf),
+                   COAP_METHOD_PUT, ELECT_COAP_PATH_STANDBY);
+    /* only CBOR, there are no legacy nodes knowing this resource */
+    size_t len = codec_put_nodes(pdu.payload,
+                                 _payload_space(&pdu, &buf[0], sizeof(req_buf)),
+                                 nodes, num);
+    if (len == 0) {
+        LOG_ERROR("%s: encoding failed!\n", __func__);
+        return 1;
+    }
+    len = gcoap_finish(&pdu, len, COAP_FORMAT_CBOR);
+
+    stats_inc(ELECT_STATS_SYNC_TX);
+    if (!_send(&buf[0], len, &addr, _resp_handler)) {
         LOG_ERROR("%s: send failed!\n", __func__);
         return 2;
     }
@@ -179,12 +1033,86 @@ int coap_put_node(ipv6_addr_t addr, ipv6_addr_t node)
 int coap_get_sensor(ipv6_addr_t addr)
 {
     LOG_DEBUG("%s: begin\n", __func__);
-    uint8_t buf[GCOAP_PDU_BUF_SIZE];
+    uint8_t *buf = req_buf;
+    coap_pkt_t pdu;
+    size_t len = gcoap_request(&pdu, &buf[0], sizeof(req_buf),
+                               COAP_METHOD_GET, ELECT_COAP_PATH_SENSOR);
+
+    ELECT_TRACE(ELECT_TRACE_POLL_TX, 0, addr.u32[3]);
+    stats_inc(ELECT_STATS_POLL_TX);
+    unsigned state = irq_disable();
+    memcpy(req_sent[req_next].token, pdu.token, GCOAP_TOKENLEN);
+    req_sent[req_next].sent = xtimer_now_usec();
+    req_next = (req_next + 1) % GCOAP_REQ_WAITING_MAX;
+    irq_restore(state);
+    if (!_send(&buf[0], len, &addr, _sensor_resp_handler)) {
+        LOG_ERROR("%s: send failed!\n", __func__);
+        return 1;
+    }
+    LOG_DEBUG("%s: done\n", __func__);
+    return 0;
+}
+
+int coap_get_sensor_group(void)
+{
+    LOG_DEBUG("%s: begin\n", __func__);
+    uint8_t *buf = req_buf;
     coap_pkt_t pdu;
-    size_t len = gcoap_request(&pdu, &buf[0], GCOAP_PDU_BUF_SIZE,
+    ipv6_addr_t group = ELECT_COAP_GROUP_ADDR;
+    size_t len = gcoap_request(&pdu, &buf[0], sizeof(req_buf),
                                COAP_METHOD_GET, ELECT_COAP_PATH_SENSOR);
+    /* responses are handled by the listener, no gcoap memo is used */
+    coap_hdr_set_type(pdu.hdr, COAP_TYPE_NON);
+    memcpy(group_token, pdu.token, GCOAP_TOKENLEN);
+    group_sent = xtimer_now_usec();
+
+    stats_inc(ELECT_STATS_POLL_TX);
+    if (listen_send(&group, ELECT_COAP_PORT, &buf[0], len) <= 0) {
+        LOG_ERROR("%s: send failed!\n", __func__);
+        return 1;
+    }
+    LOG_DEBUG("%s: done\n", __func__);
+    return 0;
+}
+
+int coap_put_sensor_group(const ipv6_addr_t *addr)
+{
+    LOG_DEBUG("%s: begin\n", __func__);
+    uint8_t *buf = req_buf;
+    uint8_t token[GCOAP_TOKENLEN];
+    unsigned state = irq_disable();
+    bool pending = leisure.pending;
+    unsigned format = leisure.format;
+    memcpy(token, leisure.token, GCOAP_TOKENLEN);
+    leisure.pending = false;
+    irq_restore(state);
+    if (!pending || (addr == NULL)) {
+        LOG_DEBUG("%s: nothing to send\n", __func__);
+        return 0;
+    }
+
+    /* gcoap can only respond from its handlers, build the response manually */
+    coap_pkt_t pdu = { .hdr = (coap_hdr_t *)buf };
+    ssize_t hdrlen = coap_build_hdr(pdu.hdr, COAP_TYPE_NON, token,
+                                    GCOAP_TOKENLEN, COAP_CODE_CONTENT,
+                                    (uint16_t)random_uint32());
+    if (hdrlen < 0) {
+        LOG_ERROR("%s: build header failed!\n", __func__);
+        return 1;
+    }
+    uint8_t *pos = &buf[hdrlen];
+    pos += coap_put_option_ct(pos, 0, (uint16_t)format);
+    *pos++ = 0xFF;
+    pdu.payload = pos;
+    elect_sample_t sample;
+    _read_sample(&sample);
+    pos += _put_sample(&pdu, &buf[0], sizeof(req_buf), format, &sample);
+    ELECT_TRACE(ELECT_TRACE_SENSOR_REQ, sample.value, sample.seq);
 
-    if (!_send(&buf[0], len, &addr)) {
+    stats_inc(ELECT_STATS_SENSOR_TX);
+    /* sent to the listener the group request came from */
+    if (listen_send(addr, ELECT_BC_NODEID_PORT, &buf[0],
+                    (size_t)(pos - buf)) <= 0) {
         LOG_ERROR("%s: send failed!\n", __func__);
         return 1;
     }
@@ -192,10 +1120,148 @@ int coap_get_sensor(ipv6_addr_t addr)
     return 0;
 }
 
+int coap_observe_sensor(ipv6_addr_t addr)
+{
+    LOG_DEBUG("%s: begin\n", __func__);
+    uint8_t *buf = req_buf;
+    uint8_t *pos = &buf[0];
+
+    /* gcoap can not add an observe option to requests, build it manually */
+    ssize_t hdrlen = coap_build_hdr((coap_hdr_t *)pos, COAP_TYPE_NON,
+                                    obs_token, GCOAP_TOKENLEN, COAP_METHOD_GET,
+                                    (uint16_t)random_uint32());
+    if (hdrlen < 0) {
+        LOG_ERROR("%s: build header failed!\n", __func__);
+        return 1;
+    }
+    pos += hdrlen;
+    /* observe value 0 (register) is encoded as empty option */
+    pos += coap_put_option(pos, 0, COAP_OPT_OBSERVE, NULL, 0);
+    pos += coap_put_option_uri(pos, COAP_OPT_OBSERVE, ELECT_COAP_PATH_SENSOR,
+                               COAP_OPT_URI_PATH);
+
+    /* sent from the listener socket, which receives the notifications */
+    if (listen_send(&addr, ELECT_COAP_PORT, &buf[0],
+                    (size_t)(pos - buf)) <= 0) {
+        LOG_ERROR("%s: send failed!\n", __func__);
+        return 1;
+    }
+    LOG_DEBUG("%s: done\n", __func__);
+    return 0;
+}
+
+int coap_notify_sensor(uint32_t max_age)
+{
+    uint8_t *buf = req_buf;
+    coap_pkt_t pdu;
+    elect_sample_t sample = {
+        .time   = xtimer_now_usec() / US_PER_MS,
+        .value  = sensor_read(),
+    };
+    unsigned state = irq_disable();
+    elect_sample_t last = obs_last;
+    unsigned format = obs_format;
+    irq_restore(state);
+    int delta = sample.value - last.value;
+
+    if ((delta < ELECT_OBS_DELTA) && (delta > -ELECT_OBS_DELTA) &&
+        ((sample.time - last.time) < max_age)) {
+        return 0;
+    }
+    switch (gcoap_obs_init(&pdu, &buf[0], sizeof(req_buf), _sensor_resource)) {
+        case GCOAP_OBS_INIT_OK:
+            break;
+        case GCOAP_OBS_INIT_UNUSED:
+            /* not observed (yet), nothing to do */
+            return 0;
+        default:
+            LOG_ERROR("%s: init notification failed!\n", __func__);
+            return 1;
+    }
+    LOG_DEBUG("%s: notify (val=%"PRIi16")\n", __func__, sample.value);
+    sample.seq = sensor_seq++;
+    size_t len = _put_sample(&pdu, &buf[0], sizeof(req_buf), format, &sample);
+    len = gcoap_finish(&pdu, len, format);
+    if (gcoap_obs_send(&buf[0], len, _sensor_resource) == 0) {
+        LOG_ERROR("%s: send failed!\n", __func__);
+        return 1;
+    }
+    stats_inc(ELECT_STATS_SENSOR_TX);
+    state = irq_disable();
+    obs_last = sample;
+    irq_restore(state);
+    return 0;
+}
+
+int coap_recv_resp(uint8_t *buf, size_t len, const sock_udp_ep_t *remote,
+                   elect_sample_t *sample)
+{
+    LOG_DEBUG("%s: begin\n", __func__);
+    coap_pkt_t pdu;
+
+    if (coap_parse(&pdu, buf, len) < 0) {
+        LOG_WARNING("%s: invalid CoAP message\n", __func__);
+        return 1;
+    }
+    /* accept responses to the latest group request and notifications */
+    if ((coap_get_token_len(&pdu) != GCOAP_TOKENLEN) ||
+        ((memcmp(pdu.token, group_token, GCOAP_TOKENLEN) != 0) &&
+         (memcmp(pdu.token, obs_token, GCOAP_TOKENLEN) != 0))) {
+        LOG_DEBUG("%s: response to outdated request\n", __func__);
+        return 1;
+    }
+    if ((coap_get_code_class(&pdu) != COAP_CLASS_SUCCESS) ||
+        (pdu.payload_len == 0) || (_parse_sample(&pdu, sample) != 0)) {
+        LOG_WARNING("%s: invalid sensor response\n", __func__);
+        return 1;
+    }
+    memcpy(&sample->addr, &remote->addr.ipv6[0], sizeof(sample->addr));
+    /* notifications are not requested, their round trip time is unknown */
+    sample->rtt = 0;
+    /* neither is that of group responses delayed by their Leisure */
+    if ((ELECT_COAP_LEISURE == 0) &&
+        (memcmp(pdu.token, group_token, GCOAP_TOKENLEN) == 0)) {
+        sample->rtt = xtimer_now_usec() - group_sent;
+    }
+    LOG_DEBUG("%s: done\n", __func__);
+    return 0;
+}
+
+void coap_set_partial(int32_t sum, uint16_t count)
+{
+    unsigned state = irq_disable();
+    part_sum = sum;
+    part_count = count;
+    irq_restore(state);
+}
+
+void coap_set_aggregate(const elect_aggregate_t *aggr)
+{
+    uint32_t now = (uint32_t)(xtimer_now_usec64() / US_PER_MS);
+    unsigned state = irq_disable();
+    aggr_last = *aggr;
+    aggr_time = now;
+    aggr_known = true;
+    irq_restore(state);
+}
+
+int coap_read_aggregate(elect_aggregate_t *aggr, uint32_t *age)
+{
+    uint32_t now = (uint32_t)(xtimer_now_usec64() / US_PER_MS);
+    unsigned state = irq_disable();
+    bool known = aggr_known;
+    *aggr = aggr_last;
+    *age = now - aggr_time;
+    irq_restore(state);
+    return known ? 0 : 1;
+}
+
 int coap_init(kernel_pid_t main)
 {
     main_pid = main;
     LOG_DEBUG("%s: begin\n", __func__);
+    uint32_t token = random_uint32();
+    memcpy(obs_token, &token, GCOAP_TOKENLEN);
     gcoap_register_listener(&_listener);
     LOG_DEBUG("%s: done\n", __func__);
     return 0;
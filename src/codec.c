@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       Minimal CBOR (RFC 7049) codec for CoAP payloads
+ *
+ * Only the subset needed by the application is supported: unsigned and
+ * negative integers, byte strings, and arrays of definite length.
+ *
+ * @}
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "log.h"
+#include "net/ipv6/addr.h"
+
+#include "elect.h"
+
+/**
+ * @name CBOR major types
+ * @{
+ */
+#define CBOR_UINT       (0x00)
+#define CBOR_NEGINT     (0x20)
+#define CBOR_BYTES      (0x40)
+#define CBOR_ARRAY      (0x80)
+#define CBOR_TYPE_MASK  (0xe0)
+#define CBOR_INFO_MASK  (0x1f)
+/** @} */
+
+/**
+ * @brief Number of items in an encoded sample, and with partial aggregate
+ */
+#define CODEC_SAMPLE_ITEMS  (3U)
+#define CODEC_PARTIAL_ITEMS (5U)
+
+/**
+ * @brief Number of items in an encoded aggregate
+ */
+#define CODEC_AGGREGATE_ITEMS   (4U)
+
+/* --- internal helper functions --- */
+
+static size_t _put_head(uint8_t *buf, size_t len, uint8_t major, uint32_t val)
+{
+    if (val < 24) {
+        if (len < 1) {
+            return 0;
+        }
+        buf[0] = major | (uint8_t)val;
+        return 1;
+    }
+    else if (val <= UINT8_MAX) {
+        if (len < 2) {
+            return 0;
+        }
+        buf[0] = major | 24;
+        buf[1] = (uint8_t)val;
+        return 2;
+    }
+    else if (val <= UINT16_MAX) {
+        if (len < 3) {
+            return 0;
+        }
+        buf[0] = major | 25;
+        buf[1] = (uint8_t)(val >> 8);
+        buf[2] = (uint8_t)val;
+        return 3;
+    }
+    if (len < 5) {
+        return 0;
+    }
+    buf[0] = major | 26;
+    buf[1] = (uint8_t)(val >> 24);
+    buf[2] = (uint8_t)(val >> 16);
+    buf[3] = (uint8_t)(val >> 8);
+    buf[4] = (uint8_t)val;
+    return 5;
+}
+
+static size_t _get_head(const uint8_t *buf, size_t len, uint8_t *major,
+                        uint32_t *val)
+{
+    if (len < 1) {
+        return 0;
+    }
+    *major = buf[0] & CBOR_TYPE_MASK;
+    uint8_t info = buf[0] & CBOR_INFO_MASK;
+    if (info < 24) {
+        *val = info;
+        return 1;
+    }
+    size_t n = (size_t)1 << (info - 24);
+    if ((info > 26) || (len < (1 + n))) {
+        return 0;
+    }
+    *val = 0;
+    for (size_t i = 1; i <= n; ++i) {
+        *val = (*val << 8) | buf[i];
+    }
+    return 1 + n;
+}
+
+static size_t _put_int(uint8_t *buf, size_t len, int32_t val)
+{
+    if (val < 0) {
+        return _put_head(buf, len, CBOR_NEGINT, (uint32_t)(-1 - val));
+    }
+    return _put_head(buf, len, CBOR_UINT, (uint32_t)val);
+}
+
+static size_t _get_int(const uint8_t *buf, size_t len, int32_t *val)
+{
+    uint8_t major;
+    uint32_t raw;
+    size_t n = _get_head(buf, len, &major, &raw);
+    if ((n == 0) || (raw > INT32_MAX)) {
+        return 0;
+    }
+    if (major == CBOR_UINT) {
+        *val = (int32_t)raw;
+    }
+    else if (major == CBOR_NEGINT) {
+        *val = -1 - (int32_t)raw;
+    }
+    else {
+        return 0;
+    }
+    return n;
+}
+
+/**
+ * @brief Decode IP address of a node
+ *
+ * @returns number of bytes read, 0 on error
+ */
+static size_t _get_node(const uint8_t *buf, size_t len, ipv6_addr_t *addr)
+{
+    uint8_t major;
+    uint32_t idlen;
+    size_t pos = _get_head(buf, len, &major, &idlen);
+    if ((pos == 0) || (major != CBOR_BYTES) || ((len - pos) < idlen)) {
+        return 0;
+    }
+    if (idlen == ELECT_FRAME_IID_LEN) {
+        memset(addr, 0, sizeof(ipv6_addr_t));
+        ipv6_addr_set_link_local_prefix(addr);
+        memcpy(&addr->u8[ELECT_FRAME_IID_LEN], &buf[pos], ELECT_FRAME_IID_LEN);
+    }
+    else if (idlen == sizeof(ipv6_addr_t)) {
+        memcpy(addr, &buf[pos], sizeof(ipv6_addr_t));
+    }
+    else {
+        return 0;
+    }
+    return pos + idlen;
+}
+
+/* --- public interface functions --- */
+
+size_t codec_put_uint(uint8_t *buf, size_t len, uint32_t val)
+{
+    return _put_head(buf, len, CBOR_UINT, val);
+}
+
+size_t codec_put_array(uint8_t *buf, size_t len, unsigned items)
+{
+    return _put_head(buf, len, CBOR_ARRAY, items);
+}
+
+size_t codec_put_sample(uint8_t *buf, size_t len, const elect_sample_t *sample)
+{
+    size_t pos = _put_head(buf, len, CBOR_ARRAY, sample->count
+                                                 ? CODEC_PARTIAL_ITEMS
+                                                 : CODEC_SAMPLE_ITEMS);
+    size_t n;
+    if ((pos == 0) ||
+        ((n = _put_int(&buf[pos], len - pos, sample->value)) == 0)) {
+        return 0;
+    }
+    pos += n;
+    if ((n = _put_head(&buf[pos], len - pos, CBOR_UINT, sample->time)) == 0) {
+        return 0;
+    }
+    pos += n;
+    if ((n = _put_head(&buf[pos], len - pos, CBOR_UINT, sample->seq)) == 0) {
+        return 0;
+    }
+    pos += n;
+    if (sample->count) {
+        if ((n = _put_int(&buf[pos], len - pos, sample->sum)) == 0) {
+            return 0;
+        }
+        pos += n;
+        if ((n = _put_head(&buf[pos], len - pos, CBOR_UINT,
+                           sample->count)) == 0) {
+            return 0;
+        }
+        pos += n;
+    }
+    return pos;
+}
+
+int codec_get_sample(const uint8_t *buf, size_t len, elect_sample_t *sample)
+{
+    uint8_t major;
+    uint32_t val;
+    int32_t ival;
+    size_t pos = _get_head(buf, len, &major, &val);
+    size_t n;
+    /* newer senders may append items, these are ignored */
+    if ((pos == 0) || (major != CBOR_ARRAY) || (val < CODEC_SAMPLE_ITEMS)) {
+        return 1;
+    }
+    unsigned items = val;
+    if (((n = _get_int(&buf[pos], len - pos, &ival)) == 0) ||
+        (ival < INT16_MIN) || (ival > INT16_MAX)) {
+        return 1;
+    }
+    sample->value = (int16_t)ival;
+    pos += n;
+    if (((n = _get_head(&buf[pos], len - pos, &major, &val)) == 0) ||
+        (major != CBOR_UINT)) {
+        return 1;
+    }
+    sample->time = val;
+    pos += n;
+    if (((n = _get_head(&buf[pos], len - pos, &major, &val)) == 0) ||
+        (major != CBOR_UINT) || (val > UINT16_MAX)) {
+        return 1;
+    }
+    sample->seq = (uint16_t)val;
+    pos += n;
+    sample->count = 0;
+    sample->sum = 0;
+    if (items < CODEC_PARTIAL_ITEMS) {
+        return 0;
+    }
+    if ((n = _get_int(&buf[pos], len - pos, &ival)) == 0) {
+        return 1;
+    }
+    sample->sum = ival;
+    pos += n;
+    if (((n = _get_head(&buf[pos], len - pos, &major, &val)) == 0) ||
+        (major != CBOR_UINT) || (val > UINT16_MAX)) {
+        return 1;
+    }
+    sample->count = (uint16_t)val;
+    return 0;
+}
+
+size_t codec_put_aggregate(uint8_t *buf, size_t len,
+                           const elect_aggregate_t *aggr, uint32_t age)
+{
+    size_t pos = _put_head(buf, len, CBOR_ARRAY, CODEC_AGGREGATE_ITEMS);
+    size_t n;
+    if ((pos == 0) ||
+        ((n = _put_int(&buf[pos], len - pos, aggr->value)) == 0)) {
+        return 0;
+    }
+    pos += n;
+    if ((n = _put_head(&buf[pos], len - pos, CBOR_UINT, age)) == 0) {
+        return 0;
+    }
+    pos += n;
+    if ((n = _put_head(&buf[pos], len - pos, CBOR_UINT, aggr->epoch)) == 0) {
+        return 0;
+    }
+    pos += n;
+    if ((n = codec_put_node(&buf[pos], len - pos, &aggr->leader)) == 0) {
+        return 0;
+    }
+    return pos + n;
+}
+
+size_t codec_put_node(uint8_t *buf, size_t len, const ipv6_addr_t *addr)
+{
+    /* link local addresses are reduced to their interface ID */
+    const uint8_t *id = &addr->u8[0];
+    size_t idlen = sizeof(ipv6_addr_t);
+    if (ipv6_addr_is_link_local(addr)) {
+        id = &addr->u8[ELECT_FRAME_IID_LEN];
+        idlen = ELECT_FRAME_IID_LEN;
+    }
+    size_t pos = _put_head(buf, len, CBOR_BYTES, idlen);
+    if ((pos == 0) || ((len - pos) < idlen)) {
+        return 0;
+    }
+    memcpy(&buf[pos], id, idlen);
+    return pos + idlen;
+}
+
+int codec_get_node(const uint8_t *buf, size_t len, ipv6_addr_t *addr)
+{
+    return (_get_node(buf, len, addr) == 0) ? 1 : 0;
+}
+
+size_t codec_put_reg(uint8_t *buf, size_t len, const elect_reg_t *reg)
+{
+    size_t pos = codec_put_node(buf, len, &reg->node);
+    if ((pos == 0) || ((reg->members == 0) && !reg->renew)) {
+        return pos;
+    }
+    /* decoders not knowing the size of the table or epoch ignore them */
+    size_t n = _put_head(&buf[pos], len - pos, CBOR_UINT, reg->members);
+    if ((n == 0) || !reg->renew) {
+        return (n == 0) ? 0 : pos + n;
+    }
+    pos += n;
+    n = _put_head(&buf[pos], len - pos, CBOR_UINT, reg->epoch);
+    return (n == 0) ? 0 : pos + n;
+}
+
+int codec_get_reg(const uint8_t *buf, size_t len, elect_reg_t *reg)
+{
+    uint8_t major;
+    uint32_t val;
+    size_t pos = _get_node(buf, len, &reg->node);
+    if (pos == 0) {
+        return 1;
+    }
+    reg->members = 0;
+    reg->renew = false;
+    reg->epoch = 0;
+    size_t n;
+    if ((pos < len) &&
+        ((n = _get_head(&buf[pos], len - pos, &major, &val)) != 0) &&
+        (major == CBOR_UINT)) {
+        reg->members = val;
+        pos += n;
+        if ((pos < len) &&
+            (_get_head(&buf[pos], len - pos, &major, &val) != 0) &&
+            (major == CBOR_UINT) && (val <= UINT16_MAX)) {
+            reg->renew = true;
+            reg->epoch = (uint16_t)val;
+        }
+    }
+    return 0;
+}
+
+size_t codec_put_nodes(uint8_t *buf, size_t len, const ipv6_addr_t *addrs,
+                       unsigned num)
+{
+    size_t pos = _put_head(buf, len, CBOR_ARRAY, num);
+    if (pos == 0) {
+        return 0;
+    }
+    for (unsigned i = 0; i < num; ++i) {
+        size_t n = codec_put_node(&buf[pos], len - pos, &addrs[i]);
+        if (n == 0) {
+            return 0;
+        }
+        pos += n;
+    }
+    return pos;
+}
+
+int codec_get_nodes(const uint8_t *buf, size_t len, ipv6_addr_t *addrs,
+                    unsigned *num)
+{
+    uint8_t major;
+    uint32_t items;
+    size_t pos = _get_head(buf, len, &major, &items);
+    if ((pos == 0) || (major != CBOR_ARRAY) || (items > *num)) {
+        return 1;
+    }
+    for (unsigned i = 0; i < items; ++i) {
+        size_t n = _get_node(&buf[pos], len - pos, &addrs[i]);
+        if (n == 0) {
+            return 1;
+        }
+        pos += n;
+    }
+    *num = items;
+    return 0;
+}
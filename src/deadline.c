@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       Deadlines of the timers of main, sharing one xtimer
+ *
+ * Each timer is an absolute deadline in ms. Rearming a timer replaces its
+ * deadline and touches the xtimer only if the deadline is due before the
+ * pending wakeup, stopping a timer just disarms it. On wakeup main takes
+ * all timers due within ELECT_DEADLINE_SLACK in order of their deadlines,
+ * and the xtimer is set once for the earliest deadline left.
+ *
+ * The wakeup is sent to main by the xtimer from interrupt context, it is
+ * lost if the queue of main is full. Main thus looks for due timers after
+ * every message, which rearms the xtimer once it has fired, and a wakeup
+ * that is overdue by more than ELECT_DEADLINE_SLACK is taken as lost when a
+ * timer is set.
+ *
+ * @}
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "log.h"
+#include "msg.h"
+#include "xtimer.h"
+
+#include "elect.h"
+
+static xtimer_t deadline_timer;
+static msg_t deadline_msg = { .type = ELECT_DEADLINE_EVENT };
+static kernel_pid_t deadline_pid = KERNEL_PID_UNDEF;
+/* absolute deadlines in ms, valid if bit of timer is set in armed */
+static uint32_t deadlines[ELECT_TIMER_NUMOF];
+static uint32_t armed;
+/* deadline the xtimer is set for, if waiting */
+static uint32_t wakeup;
+static bool waiting;
+
+/* --- internal helper functions --- */
+
+/**
+ * @brief Current time in ms, 64 bit base as the us counter wraps in 71 min
+ */
+static uint32_t _now(void)
+{
+    return (uint32_t)(xtimer_now_usec64() / US_PER_MS);
+}
+
+/**
+ * @returns true if deadline @p a is before @p b, robust against wrap around
+ */
+static bool _before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+static void _wakeup(uint32_t at, uint32_t now)
+{
+    uint32_t offset = _before(now, at) ? (at - now) : 0;
+    wakeup = at;
+    waiting = true;
+    xtimer_set_msg(&deadline_timer, offset * US_PER_MS, &deadline_msg,
+                   deadline_pid);
+}
+
+/* --- public interface functions --- */
+
+void deadline_init(kernel_pid_t pid)
+{
+    deadline_pid = pid;
+    armed = 0;
+    waiting = false;
+}
+
+void deadline_set(unsigned timer, uint32_t offset)
+{
+    uint32_t now = _now();
+    uint32_t at = now + offset;
+    deadlines[timer] = at;
+    armed |= (1U << timer);
+    if (waiting && _before(wakeup + ELECT_DEADLINE_SLACK, now)) {
+        /* wakeup got lost, restart from the earliest deadline */
+        for (unsigned i = 0; i < ELECT_TIMER_NUMOF; ++i) {
+            if ((armed & (1U << i)) && _before(deadlines[i], at)) {
+                at = deadlines[i];
+            }
+        }
+        _wakeup(at, now);
+    }
+    /* a later deadline is picked up by the pending wakeup */
+    else if (!waiting || _before(at + ELECT_DEADLINE_SLACK, wakeup)) {
+        _wakeup(at, now);
+    }
+}
+
+void deadline_stop(unsigned timer)
+{
+    /* a pending wakeup for this deadline finds nothing to expire */
+    armed &= ~(1U << timer);
+}
+
+int deadline_next(void)
+{
+    int next = -1;
+    for (unsigned i = 0; i < ELECT_TIMER_NUMOF; ++i) {
+        if ((armed & (1U << i)) &&
+            ((next < 0) || _before(deadlines[i], deadlines[next]))) {
+            next = (int)i;
+        }
+    }
+    if (next < 0) {
+        waiting = false;
+        return -1;
+    }
+    uint32_t now = _now();
+    if (_before(now + ELECT_DEADLINE_SLACK, deadlines[next])) {
+        /* a pending wakeup is left alone, a fired or lost one is replaced */
+        if (!waiting || !_before(now, wakeup)) {
+            _wakeup(deadlines[next], now);
+        }
+        return -1;
+    }
+    armed &= ~(1U << next);
+    return next;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       Cache of recent senders of node IDs, to drop repeats
+ *
+ * Nodes in DISCOVER repeat their ID every interval, and gossip repeats the
+ * highest ID. A repeat from the same sender within the window, 1.5 times
+ * the interval by default (ELECT_DEDUP_WINDOW), carries no news for main.
+ * A new sender, as a joining node, or a changed ID, as a new highest ID,
+ * always passes, as does each repeat once the window has passed, so main
+ * still learns that the sender is alive.
+ *
+ * @}
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "elect.h"
+
+/* --- public interface functions --- */
+
+void dedup_init(elect_dedup_t *dedup)
+{
+    memset(dedup, 0, sizeof(*dedup));
+    dedup->window = ELECT_DEDUP_WINDOW;
+}
+
+bool dedup_check(elect_dedup_t *dedup, const uint8_t *sender,
+                 const ipv6_addr_t *id, uint32_t now)
+{
+    if (!ELECT_DEDUP) {
+        return false;
+    }
+    elect_dedup_entry_t *slot = &dedup->entries[0];
+    for (unsigned i = 0; i < ELECT_DEDUP_NUM; ++i) {
+        elect_dedup_entry_t *entry = &dedup->entries[i];
+        if (entry->used &&
+            (memcmp(entry->sender, sender, ELECT_FRAME_IID_LEN) == 0)) {
+            if ((ipv6_addr_cmp(&entry->id, id) == 0) &&
+                ((now - entry->time) < dedup->window)) {
+                return true;
+            }
+            slot = entry;
+            break;
+        }
+        /* unused entries first, then the least recent sender */
+        if (slot->used &&
+            (!entry->used || ((now - entry->time) > (now - slot->time)))) {
+            slot = entry;
+        }
+    }
+    slot->id = *id;
+    memcpy(slot->sender, sender, ELECT_FRAME_IID_LEN);
+    slot->time = now;
+    slot->used = true;
+    return false;
+}
+
+void dedup_forget(elect_dedup_t *dedup, const uint8_t *sender)
+{
+    for (unsigned i = 0; i < ELECT_DEDUP_NUM; ++i) {
+        elect_dedup_entry_t *entry = &dedup->entries[i];
+        if (entry->used &&
+            (memcmp(entry->sender, sender, ELECT_FRAME_IID_LEN) == 0)) {
+            entry->used = false;
+            return;
+        }
+    }
+}
@@ -23,6 +23,7 @@
 #include <stdbool.h>
 
 #include "net/ipv6/addr.h"
+#include "net/sock/udp.h"
 #include "xtimer.h"
 
 #ifdef __cplusplus
@@ -36,6 +37,13 @@ extern "C" {
 #define ELECT_NODES_NUM         (8)
 #endif
 
+#ifndef ELECT_MEMBERS_NUM
+/**
+ * @brief Capacity of the coordinator's membership table
+ */
+#define ELECT_MEMBERS_NUM       (ELECT_NODES_NUM)
+#endif
+
 /**
  * @name Parameters for the election algorithm
  * @{
@@ -45,10 +53,56 @@ extern "C" {
 #define ELECT_LEADER_TIMEOUT    (7U * ELECT_MSG_INTERVAL)   /**< timeout after which a leader is dead */
 /** @} */
 
+/**
+ * @name Modes for aggregation of sensor values by the coordinator
+ * @{
+ */
+#define ELECT_AGGR_EWMA         (0)     /**< moving average, updated per response */
+#define ELECT_AGGR_MEAN         (1)     /**< arithmetic mean of a polling round */
+#define ELECT_AGGR_DECAY        (2)     /**< mean of all rounds, older rounds decayed */
+#define ELECT_AGGR_LAST         (3)     /**< mean of the latest value of each member */
+/** @} */
+
+#ifndef ELECT_AGGR_MODE
+/**
+ * @brief Mode used by the coordinator to aggregate sensor values
+ *
+ * With ELECT_AGGR_EWMA the aggregate is broadcast after each response,
+ * with the other modes once per interval. ELECT_AGGR_LAST caches the
+ * latest sample of each member, a member counts once no matter how often
+ * it responds, and its value is dropped after ELECT_AGGR_MAX_AGE. Partial
+ * aggregates of group heads are weighted by their number of values, except
+ * for ELECT_AGGR_EWMA.
+ */
+#define ELECT_AGGR_MODE         (ELECT_AGGR_LAST)
+#endif
+
+#ifndef ELECT_AGGR_MAX_AGE
+/**
+ * @brief Time in ms after which a member's cached value is dropped, if it
+ *        was not heard of, for ELECT_AGGR_LAST
+ */
+#define ELECT_AGGR_MAX_AGE      (3U * ELECT_MSG_INTERVAL)
+#endif
+
+#ifndef ELECT_WEIGHT_SHIFT
+/**
+ * @brief Weight of a new value for ELECT_AGGR_EWMA is 2^-ELECT_WEIGHT_SHIFT
+ */
+#define ELECT_WEIGHT_SHIFT      (4U)
+#endif
+
 /**
  * @brief Weight for exponentially weighted moving average
  */
-#define ELECT_WEIGHT            (16)
+#define ELECT_WEIGHT            (1 << ELECT_WEIGHT_SHIFT)
+
+#ifndef ELECT_DECAY_SHIFT
+/**
+ * @brief Decay per interval for ELECT_AGGR_DECAY is 1 - 2^-ELECT_DECAY_SHIFT
+ */
+#define ELECT_DECAY_SHIFT       (1U)
+#endif
 
 /**
  * @name Broadcast configuration for IDs
@@ -59,8 +113,32 @@ extern "C" {
 #define ELECT_BC_NODEID_WAIT    (5000U)
 /** @} */
 
+/**
+ * @name Binary frame format for broadcasts
+ *
+ * Every frame starts with a header byte, its upper nibble holds the format
+ * version and the lower nibble the frame type. Headers of version 1 are
+ * below 0x20, thus they never clash with the legacy textual format, which
+ * is still accepted by the listener.
+ * @{
+ */
+#define ELECT_FRAME_VERSION     (1U)
+#define ELECT_FRAME_HDR(type)   ((uint8_t)((ELECT_FRAME_VERSION << 4) | (type)))
+#define ELECT_FRAME_VER(hdr)    ((hdr) >> 4)
+#define ELECT_FRAME_TYPE(hdr)   ((hdr) & 0x0f)
+#define ELECT_FRAME_NODEID      (0x1)   /**< node ID as full IPv6 address */
+#define ELECT_FRAME_NODEID_IID  (0x2)   /**< node ID as interface ID of link local address */
+#define ELECT_FRAME_STANDBY     (0x3)   /**< epoch, leader IID, and standby IID if any */
+#define ELECT_FRAME_AGGREGATE   (0x4)   /**< epoch, aggregate, interval, and leader IID */
+#define ELECT_FRAME_IID_LEN     (8U)    /**< length of an interface ID */
+/** @} */
+
 /**
  * @name Broadcast configuration for sensor values
+ *
+ * The coordinator sends the aggregate as ELECT_FRAME_AGGREGATE to this
+ * group, clients join it and take each frame of their coordinator as sign
+ * of life, in addition to its requests.
  * @{
  */
 #define ELECT_BC_SENSOR_ADDR    {{  0xff, 0x02, 0x00, 0x00, \
@@ -71,6 +149,106 @@ extern "C" {
 #define ELECT_BC_SENSOR_LEN     (8U)
 /** @} */
 
+/**
+ * @name CoAP configuration
+ * @{
+ */
+#define ELECT_COAP_PORT         (5683U)
+#define ELECT_COAP_GROUP_ADDR   IPV6_ADDR_ALL_NODES_LINK_LOCAL
+/** buffer for requests of main, fits a chunk of members for the standby */
+#define ELECT_COAP_BUF_SIZE     (32U + ELECT_STANDBY_CHUNK * (1U + sizeof(ipv6_addr_t)))
+/** @} */
+
+/**
+ * @name Modes for polling sensor values of clients
+ * @{
+ */
+#define ELECT_POLL_UNICAST      (0)     /**< one CoAP GET per client */
+#define ELECT_POLL_GROUP        (1)     /**< one CoAP GET to group address */
+#define ELECT_POLL_OBSERVE      (2)     /**< clients push values via CoAP observe */
+/** @} */
+
+#ifndef ELECT_POLL_MODE
+/**
+ * @brief Mode used by the coordinator to poll sensor values
+ */
+#define ELECT_POLL_MODE         (ELECT_POLL_GROUP)
+#endif
+
+/**
+ * @name Parameters for paced polling in unicast mode
+ * @{
+ */
+#ifndef ELECT_POLL_WINDOW
+#define ELECT_POLL_WINDOW       (4U)    /**< max. number of requests in flight */
+#endif
+#ifndef ELECT_POLL_SPREAD
+#define ELECT_POLL_SPREAD       (75U)   /**< share of interval in % to spread requests over */
+#endif
+/** @} */
+
+#ifndef ELECT_COAP_LEISURE
+/**
+ * @brief Share of the leader's interval in % that responses to a group
+ *        request are spread over, 0 to respond at once
+ *
+ * Each member delays its response by a random Leisure (RFC 7252, 8.2), so
+ * the responses do not arrive at the coordinator all at once. The default
+ * is the time the coordinator reserves for a round, see
+ * ELECT_TIMING_HEADROOM.
+ */
+#define ELECT_COAP_LEISURE      (100U / ELECT_TIMING_HEADROOM)
+#endif
+
+/**
+ * @name Parameters for CoAP observe of sensor values
+ * @{
+ */
+#ifndef ELECT_OBS_DELTA
+#define ELECT_OBS_DELTA         (10)                        /**< value change that triggers a notification */
+#endif
+#ifndef ELECT_OBS_MAX_AGE
+#define ELECT_OBS_MAX_AGE       (2U * ELECT_MSG_INTERVAL)   /**< max. time in ms between notifications */
+#endif
+#define ELECT_OBS_REFRESH       (ELECT_LEADER_TIMEOUT / 3U) /**< interval of registration refresh in ms */
+/** @} */
+
+/**
+ * @name Parameters for the registration of clients
+ *
+ * A client repeats its registration until the node it registers with
+ * acknowledges it, the timeout doubles with every attempt. Once registered,
+ * it re-announces itself with a non-confirmable PUT if it was not polled
+ * for ELECT_REG_ANNOUNCE, as the coordinator may have lost it. All of them
+ * are scaled to the interval the coordinator announces with its aggregate.
+ * @{
+ */
+#ifndef ELECT_REG_TIMEOUT
+#define ELECT_REG_TIMEOUT       (ELECT_MSG_INTERVAL / 2U)   /**< initial timeout of a registration in ms */
+#endif
+#define ELECT_REG_TIMEOUT_MAX   (ELECT_LEADER_TIMEOUT / 2U) /**< max. timeout of a registration in ms */
+#ifndef ELECT_REG_ANNOUNCE
+#define ELECT_REG_ANNOUNCE      (ELECT_LEADER_TIMEOUT / 2U) /**< time in ms without poll before a re-announce */
+#endif
+/** @} */
+
+#ifndef ELECT_GROUPS
+/**
+ * @brief Number of groups for two-level aggregation, 0 polls all clients
+ *        from the coordinator
+ *
+ * Clients are assigned to a group by a hash of their interface ID. The
+ * first client of a group to register becomes its head. The coordinator
+ * redirects further registrations to the head and polls heads only, heads
+ * poll their members and respond with a partial `(sum, count)` aggregate.
+ */
+#define ELECT_GROUPS            (0U)
+#endif
+
+#if ELECT_GROUPS && (ELECT_POLL_MODE != ELECT_POLL_UNICAST)
+#error "ELECT_GROUPS requires ELECT_POLL_MODE == ELECT_POLL_UNICAST"
+#endif
+
 /**
  * @name IPC message types for events
  * @{
@@ -82,95 +260,1413 @@ extern "C" {
 #define ELECT_LEADER_TIMEOUT_EVENT      (0x0819)
 #define ELECT_NODES_EVENT               (0x0820)
 #define ELECT_SENSOR_EVENT              (0x0821)
+#define ELECT_POLL_EVENT                (0x0822)
+#define ELECT_POLL_DONE_EVENT           (0x0823)
+#define ELECT_BENCH_EVENT               (0x0824)
+#define ELECT_GOSSIP_EVENT              (0x0825)
+#define ELECT_RELAY_EVENT               (0x0826)
+#define ELECT_PARENT_EVENT              (0x0827)
+#define ELECT_STANDBY_EVENT             (0x0828)
+#define ELECT_SYNC_EVENT                (0x0829)
+#define ELECT_AGGREGATE_EVENT           (0x082a)
+#define ELECT_DEADLINE_EVENT            (0x082b)
+#define ELECT_LIST_EVENT                (0x082c)
+#define ELECT_SEED_EVENT                (0x082d)
+#define ELECT_REGISTER_EVENT            (0x082e)
+#define ELECT_REGISTERED_EVENT          (0x082f)
+#define ELECT_LEISURE_EVENT             (0x0830)
 
 /** @} */
 
+#ifndef ELECT_GOSSIP
 /**
- * @brief Init CoAP handlers
- *
- * @param[in] main  process ID of main thread, needed for IPC
+ * @brief Send node ID broadcasts adaptively, following Trickle (RFC 6206)
  *
- * @returns 0 on success, error otherwise
+ * Instead of broadcasting the own ID every ELECT_MSG_INTERVAL while in
+ * DISCOVER, nodes in DISCOVER and ELECT broadcast the highest ID they know
+ * once per interval, unless they heard it ELECT_GOSSIP_K times already.
+ * The interval doubles up to ELECT_GOSSIP_DOUBLINGS times, and restarts
+ * at ELECT_GOSSIP_IMIN when a higher ID is heard.
  */
-int coap_init(kernel_pid_t main);
+#define ELECT_GOSSIP            (1)
+#endif
 
+#ifndef ELECT_GOSSIP_IMIN
 /**
- * @brief Start broadcast listener
- *
- * @returns 0 on success, error otherwise
+ * @brief Minimum interval of adaptive broadcasts in ms
  */
-int listen_init(kernel_pid_t main);
+#define ELECT_GOSSIP_IMIN       (ELECT_MSG_INTERVAL / 4)
+#endif
 
+#ifndef ELECT_GOSSIP_DOUBLINGS
 /**
- * @brief Init network interface
- *
- * Set channel, TX power, PAN ID, IP addresses as necessary. Can be empty,
- * if no specific configuration is required.
- *
- * @param[in] main  process ID of main thread, needed for IPC
- *
- * @returns 0 on success, error otherwise
+ * @brief Number of doublings of ELECT_GOSSIP_IMIN for the maximum interval
  */
-int net_init(kernel_pid_t main);
+#define ELECT_GOSSIP_DOUBLINGS  (4U)
+#endif
 
+#ifndef ELECT_GOSSIP_K
 /**
- * @brief Init sensor
- *
- * @returns 0 on success, error otherwise
+ * @brief Redundancy constant, broadcasts of best ID that suppress our own
  */
-int sensor_init(void);
+#define ELECT_GOSSIP_K          (2U)
+#endif
 
+#ifndef ELECT_DEDUP
 /**
- * @brief Get temperature sensor value
+ * @brief Drop repeated node IDs in the listener, before they reach main
  *
- * @returns Temperature value as degree Celsius x100
+ * The listener remembers the last node ID of ELECT_DEDUP_NUM recent
+ * senders. The same ID from the same sender within ELECT_DEDUP_WINDOW,
+ * scaled along with the interval, is dropped, a new sender or a changed ID
+ * is passed on.
  */
-int16_t sensor_read(void);
+#define ELECT_DEDUP             (1)
+#endif
 
 /**
- * @brief Send IP address via IPv6 multicast to `ff02::1`
+ * @name Parameters of the recent sender cache
+ * @{
+ */
+#ifndef ELECT_DEDUP_NUM
+#define ELECT_DEDUP_NUM         (ELECT_NODES_NUM)       /**< number of senders, at least 1 */
+#endif
+#ifndef ELECT_DEDUP_WINDOW
+#define ELECT_DEDUP_WINDOW      (3U * ELECT_MSG_INTERVAL / 2U)  /**< time in ms a repeated ID is dropped */
+#endif
+/** @} */
+
+#ifndef ELECT_STANDBY
+/**
+ * @brief Fail over to a standby leader, without a new election
  *
- * @param[in] ip    IP address
+ * The coordinator designates its highest registered client as standby,
+ * announces it to all nodes, and sends it the membership table in chunks.
+ * If the coordinator is silent for ELECT_STANDBY_TIMEOUT, the standby
+ * takes over and announces itself with a higher epoch; clients register
+ * with it directly.
+ */
+#define ELECT_STANDBY           (1)
+#endif
+
+/**
+ * @name Parameters for the standby leader
+ * @{
+ */
+#ifndef ELECT_STANDBY_TIMEOUT
+#define ELECT_STANDBY_TIMEOUT   (5U * ELECT_MSG_INTERVAL / 2U)  /**< timeout after which the standby takes over */
+#endif
+#define ELECT_STANDBY_ANNOUNCE  (ELECT_LEADER_TIMEOUT / 2U)     /**< max. interval of standby announcements in ms */
+#define ELECT_STANDBY_CHUNK     (8U)    /**< members sent to the standby per interval */
+/** @} */
+
+#ifndef ELECT_HANDOFF
+/**
+ * @brief Hand the membership table over to a new coordinator
  *
- * @returns 0 on success, or error otherwise
+ * A node that won an election against a live coordinator fetches the
+ * members of the latter via `GET /nodes`, block by block, instead of waiting
+ * for the registration of every client. If it knows of no such node, it
+ * fetches them from the first client registering with a membership table of
+ * its own, e.g. the former coordinator. A node that becomes coordinator
+ * again keeps the members of its last term.
  */
-int broadcast_id(const ipv6_addr_t *ip);
+#define ELECT_HANDOFF           (1)
+#endif
 
 /**
- * @brief Send value via IPv6 multicast to `ff02::2017`
+ * @name Blocks of `GET /nodes`
  *
- * @param[in] value Sensor value
+ * The resource is a sequence of 8 byte interface IDs, sent in blocks of
+ * 2^(ELECT_NODES_BLOCK_SZX + 4) bytes, see RFC 7959.
+ * @{
+ */
+#define ELECT_NODES_BLOCK_SZX   (2U)
+#define ELECT_NODES_BLOCK       ((16U << ELECT_NODES_BLOCK_SZX) / ELECT_FRAME_IID_LEN)  /**< members per block */
+#define ELECT_NODES_RETRIES     (3U)    /**< requests of a block repeated after a timeout */
+/** @} */
+
+#ifndef ELECT_TIMING
+/**
+ * @brief Adapt intervals and timeouts to the network at runtime
  *
- * @returns 0 on success, or error otherwise
+ * The parameters of the election above are scaled by the conditions a node
+ * observes: the coordinator and group heads derive the interval from the
+ * round trip time of sensor requests and the number of members, clients
+ * derive the leader timeout from the gaps between requests and aggregates
+ * of the coordinator, and nodes in election derive the threshold from the
+ * time it took to hear the highest node ID before. Periods given relative
+ * to ELECT_MSG_INTERVAL are scaled along with the interval.
  */
-int broadcast_sensor(int16_t value);
+#define ELECT_TIMING            (1)
+#endif
 
 /**
- * @brief Send IP address of node to leader node using CoAP PUT
+ * @name Bounds and parameters of adaptive timing
+ * @{
+ */
+#ifndef ELECT_TIMING_INTERVAL_MIN
+#define ELECT_TIMING_INTERVAL_MIN   (ELECT_MSG_INTERVAL / 2U)       /**< min. interval in ms */
+#endif
+#ifndef ELECT_TIMING_INTERVAL_MAX
+#define ELECT_TIMING_INTERVAL_MAX   (4U * ELECT_MSG_INTERVAL)       /**< max. interval in ms */
+#endif
+#ifndef ELECT_TIMING_THRESHOLD_MIN
+#define ELECT_TIMING_THRESHOLD_MIN  (ELECT_MSG_INTERVAL)            /**< min. leader threshold in ms */
+#endif
+#ifndef ELECT_TIMING_THRESHOLD_MAX
+#define ELECT_TIMING_THRESHOLD_MAX  (2U * ELECT_LEADER_THRESHOLD)   /**< max. leader threshold in ms */
+#endif
+#ifndef ELECT_TIMING_TIMEOUT_MIN
+#define ELECT_TIMING_TIMEOUT_MIN    (2U * ELECT_MSG_INTERVAL)       /**< min. leader timeout in ms */
+#endif
+#ifndef ELECT_TIMING_TIMEOUT_MAX
+#define ELECT_TIMING_TIMEOUT_MAX    (2U * ELECT_LEADER_TIMEOUT)     /**< max. leader timeout in ms */
+#endif
+#ifndef ELECT_TIMING_RTT_INIT
+#define ELECT_TIMING_RTT_INIT       (50U * US_PER_MS)   /**< round trip time in us assumed until measured */
+#endif
+#ifndef ELECT_TIMING_SLOT
+#define ELECT_TIMING_SLOT           (2U * US_PER_MS)    /**< time in us to receive one response */
+#endif
+#ifndef ELECT_TIMING_THRESHOLD_MULT
+#define ELECT_TIMING_THRESHOLD_MULT (4U)    /**< leader threshold per time to learn the highest ID */
+#endif
+#define ELECT_TIMING_HEADROOM       (2U)    /**< interval per time needed for a round */
+#define ELECT_TIMING_DECAY_SHIFT    (3U)    /**< maxima decay by 2^-n per sample */
+/** @} */
+
+#ifndef ELECT_DEADLINE_SLACK
+/**
+ * @brief Timers due within this many ms of a wakeup expire with it
  *
- * @param[in] addr  IP address of leader node
- * @param[in] node  IP address of local node
+ * All timers of main share one xtimer, so deadlines close together are
+ * coalesced into one wakeup, and a timer is only rearmed for a deadline
+ * earlier than the pending wakeup by more than this.
+ */
+#define ELECT_DEADLINE_SLACK    (10U)
+#endif
+
+/**
+ * @name Sampling of the sensor by a background thread
+ * @{
+ */
+#ifndef ELECT_SENSOR_PERIOD
+#define ELECT_SENSOR_PERIOD     (ELECT_MSG_INTERVAL / 4U)   /**< sampling period in ms */
+#endif
+#ifndef ELECT_SENSOR_FILTER
+#define ELECT_SENSOR_FILTER     (0U)    /**< smoothing, a sample weighs 2^-n, 0 disables */
+#endif
+/** @} */
+
+#ifndef ELECT_LEAN
+/**
+ * @brief Size stacks and queues for a small footprint
  *
- * @returns 0 on succes, error otherwise
+ * Threads get stacks of the minimum size of the CPU plus the measured use
+ * of the application, see below, instead of the defaults of RIOT. Room for
+ * printf is only added if a thread has log output compiled in.
  */
-int coap_put_node(ipv6_addr_t addr, ipv6_addr_t node);
+#define ELECT_LEAN              (0)
+#endif
 
 /**
- * @brief Get sensor reading from a node
+ * @name Stack use of the threads in bytes, for ELECT_LEAN
  *
- * @param[in] addr  IP address of node
+ * Deepest call chain of each thread within the application, as reported by
+ * `bench/footprint.py --callgraph` for a `CALLGRAPH=1 LOG_LEVEL=LOG_NONE`
+ * build, the largest of gcc -Os and -O2 for x86-64 with all poll modes and
+ * tracing. Frames of 32 bit targets are smaller. ELECT_STACK_MARGIN is added
+ * for the RIOT functions at the end of each chain, e.g. sock_udp_recv() or
+ * xtimer_periodic_wakeup(), and the context the CPU saves on a switch. With
+ * RIOT built with CALLGRAPH=1 too, footprint.py includes its functions, and
+ * the `stack:` line of DEVELHELP builds shows the high-water marks.
+ * @{
+ */
+#define ELECT_LISTEN_STACK_USE  (576U)  /**< listener, down to codec_get_sample() */
+#define ELECT_AGGR_STACK_USE    (192U)  /**< aggregate thread, down to listen_release() */
+#define ELECT_SENSOR_STACK_USE  (96U)   /**< sensor thread, down to trace_add() */
+#ifndef ELECT_STACK_MARGIN
+#define ELECT_STACK_MARGIN      (384U)  /**< for RIOT functions and CPU context */
+#endif
+/**
+ * @brief Lean stack size for a thread that uses @p use bytes, and logs at
+ *        @p level at most
+ */
+#define ELECT_STACK_LEAN(use, level) \
+    (THREAD_STACKSIZE_MINIMUM + (use) + ELECT_STACK_MARGIN + \
+     ((LOG_LEVEL >= (level)) ? THREAD_EXTRA_STACKSIZE_PRINTF : 0))
+/** @} */
+
+/**
+ * @name Stacks and message queues of the threads
+ * @{
+ */
+#ifndef ELECT_MAIN_QUEUE_SIZE
+#define ELECT_MAIN_QUEUE_SIZE   (ELECT_LEAN ? 8U : ELECT_NODES_NUM)     /**< must be a power of 2 */
+#endif
+#ifndef ELECT_LISTEN_STACKSIZE
+#define ELECT_LISTEN_STACKSIZE  (ELECT_LEAN ? ELECT_STACK_LEAN(ELECT_LISTEN_STACK_USE, LOG_ERROR) : THREAD_STACKSIZE_MAIN)
+#endif
+#ifndef ELECT_AGGR_STACKSIZE
+#define ELECT_AGGR_STACKSIZE    (ELECT_LEAN ? ELECT_STACK_LEAN(ELECT_AGGR_STACK_USE, LOG_WARNING) : THREAD_STACKSIZE_DEFAULT)
+#endif
+#ifndef ELECT_SENSOR_STACKSIZE
+#define ELECT_SENSOR_STACKSIZE  (ELECT_LEAN ? ELECT_STACK_LEAN(ELECT_SENSOR_STACK_USE, LOG_DEBUG) : THREAD_STACKSIZE_DEFAULT)
+#endif
+/** @} */
+
+#ifndef ELECT_BENCH
+/**
+ * @brief Print state changes and statistics periodically for benchmarks
+ */
+#define ELECT_BENCH             (0)
+#endif
+
+#ifndef ELECT_TRACE_NUM
+/**
+ * @brief Number of records in trace buffer, 0 disables tracing
+ */
+#define ELECT_TRACE_NUM         (0U)
+#endif
+
+/**
+ * @name Event IDs of trace records
+ * @{
+ */
+#define ELECT_TRACE_EVENT       (0x01)  /**< main event, args: type, state */
+#define ELECT_TRACE_UDP_TX      (0x02)  /**< UDP send, args: port, result */
+#define ELECT_TRACE_UDP_RX      (0x03)  /**< UDP receive, args: port, length */
+#define ELECT_TRACE_COAP_RESP   (0x04)  /**< CoAP response, args: state, code */
+#define ELECT_TRACE_SENSOR_REQ  (0x05)  /**< /sensor request, args: value, seq */
+#define ELECT_TRACE_SENSOR_READ (0x06)  /**< sensor read, args: value */
+#define ELECT_TRACE_POLL_TX     (0x07)  /**< poll request, args: -, node IID */
+/** @} */
+
+#if ELECT_TRACE_NUM
+/**
+ * @brief Add record to trace buffer
+ */
+#define ELECT_TRACE(event, arg0, arg1)  \
+    trace_add((event), (uint16_t)(arg0), (uint32_t)(arg1))
+#else
+#define ELECT_TRACE(event, arg0, arg1)
+#endif
+
+/**
+ * @name Runtime statistics
+ * @{
+ */
+#define ELECT_STATS_BUCKETS     (6U)    /**< number of latency histogram buckets */
+#define ELECT_STATS_BUCKET_MIN  (64U)   /**< upper bound of first bucket in us */
+#define ELECT_STATS_BLOCK_SZX   (2U)    /**< /stats is sent in blocks of 2^(SZX+4) bytes */
+/** @} */
+
+/**
+ * @name Counters of runtime statistics
+ * @{
+ */
+#define ELECT_STATS_BCAST_TX            (0U)    /**< node ID broadcasts sent */
+#define ELECT_STATS_BCAST_RX            (1U)    /**< node ID broadcasts received */
+#define ELECT_STATS_POLL_TX             (2U)    /**< poll requests sent */
+#define ELECT_STATS_COAP_TIMEOUT        (3U)    /**< CoAP requests timed out */
+#define ELECT_STATS_COAP_ERROR          (4U)    /**< CoAP requests failed */
+#define ELECT_STATS_ROLE_CHANGE         (5U)    /**< state transitions */
+#define ELECT_STATS_RX_DROP             (6U)    /**< datagrams dropped by listener */
+#define ELECT_STATS_ROUND_INCOMPLETE    (7U)    /**< poll rounds not all members responded */
+#define ELECT_STATS_SENSOR_TX           (8U)    /**< sensor responses and notifications sent */
+#define ELECT_STATS_BCAST_DUP           (9U)    /**< repeated node IDs dropped by listener */
+#define ELECT_STATS_REG_RETRY           (10U)   /**< registrations repeated or re-announced */
+#define ELECT_STATS_AGGR_TX             (11U)   /**< aggregate multicasts sent */
+#define ELECT_STATS_STANDBY_TX          (12U)   /**< standby announcements sent */
+#define ELECT_STATS_SYNC_TX             (13U)   /**< chunks of members sent to the standby */
+#define ELECT_STATS_NODES_TX            (14U)   /**< blocks of members requested */
+#define ELECT_STATS_REG_TX              (15U)   /**< registrations sent, with repeats */
+#define ELECT_STATS_ANNOUNCE_TX         (16U)   /**< re-announces sent */
+#define ELECT_STATS_NUMOF               (17U)
+/** @} */
+
+/**
+ * @name Timers of the state machine, each delivers one event type
+ * @{
+ */
+#define ELECT_TIMER_INTERVAL            (0U)    /**< ELECT_INTERVAL_EVENT */
+#define ELECT_TIMER_LEADER_TIMEOUT      (1U)    /**< ELECT_LEADER_TIMEOUT_EVENT */
+#define ELECT_TIMER_LEADER_THRESHOLD    (2U)    /**< ELECT_LEADER_THRESHOLD_EVENT */
+#define ELECT_TIMER_GOSSIP              (3U)    /**< ELECT_GOSSIP_EVENT */
+#define ELECT_TIMER_REGISTER            (4U)    /**< ELECT_REGISTER_EVENT */
+#define ELECT_TIMER_BENCH               (5U)    /**< ELECT_BENCH_EVENT, RIOT only */
+#define ELECT_TIMER_NUMOF               (6U)
+/** @} */
+
+/**
+ * @brief Roles of a node in the leader election
+ */
+typedef enum {
+    ELECT_STATE_DISCOVER,       /**< broadcasting own ID */
+    ELECT_STATE_ELECT,          /**< heard a higher ID, waiting for result */
+    ELECT_STATE_CLIENT,         /**< registered with a coordinator */
+    ELECT_STATE_COORDINATOR,    /**< polling clients and aggregating */
+} elect_state_t;
+
+/**
+ * @brief State of the adaptive node ID broadcasts
+ */
+typedef struct {
+    ipv6_addr_t best;           /**< highest node ID known */
+    uint32_t interval;          /**< current interval in ms */
+    uint32_t rest;              /**< time from broadcast to end of interval */
+    uint8_t heard;              /**< broadcasts of best ID heard in interval */
+    bool sent;                  /**< broadcast point of interval has passed */
+} elect_gossip_t;
+
+/**
+ * @brief Last node ID heard from a sender
+ */
+typedef struct {
+    ipv6_addr_t id;                         /**< node ID */
+    uint8_t sender[ELECT_FRAME_IID_LEN];    /**< interface ID of sender */
+    uint32_t time;                          /**< time ID was passed on in ms */
+    bool used;                              /**< entry is valid */
+} elect_dedup_entry_t;
+
+/**
+ * @brief Cache of recent senders of node IDs
+ */
+typedef struct {
+    elect_dedup_entry_t entries[ELECT_DEDUP_NUM];   /**< senders */
+    uint32_t window;                                /**< time in ms a repeated
+                                                         ID is dropped */
+} elect_dedup_t;
+
+/**
+ * @brief Accumulator for aggregation of sensor values
  *
- * @returns 0 on success, error otherwise
+ * Values and weights are kept in Q16.16 fixed point, so neither rounding
+ * nor division takes place when a value is added.
  */
-int coap_get_sensor(ipv6_addr_t addr);
+typedef struct {
+    int64_t sum;                /**< weighted sum of values */
+    int64_t weight;             /**< sum of weights, unused for EWMA */
+    int16_t own;                /**< own value, for ELECT_AGGR_LAST */
+} elect_aggr_t;
 
 /**
- * @brief Get link local IP address as string of this node
+ * @brief State of adaptive timing
  *
- * @param[out] addr     Node link local IP address as binary,
- *                      IPV6_ADDR_UNSPECIFIED on error
+ * Gaps and times are tracked as maximum that decays with every further
+ * sample, so a single lost message raises them at once, while they recover
+ * slowly.
  */
-void get_node_ip_addr(ipv6_addr_t *addr);
+typedef struct {
+    uint32_t interval;          /**< current interval in ms */
+    uint32_t srtt;              /**< smoothed round trip time in us, 0 if none */
+    uint32_t rttvar;            /**< variation of round trip time in us */
+    uint32_t learn;             /**< max. time to learn the highest ID in ms */
+    uint32_t elect_start;       /**< start of current election in ms */
+    uint32_t alive_gap;         /**< max. gap between signs of life of the leader in ms */
+    uint32_t alive_last;        /**< time of last sign of life of the leader in ms,
+                                     0 if none */
+    uint32_t leader_interval;   /**< interval announced by the leader in ms,
+                                     0 if none yet */
+} elect_timing_t;
+
+/**
+ * @brief State of the leader election and aggregation of a node
+ */
+typedef struct {
+    elect_state_t state;        /**< current role */
+    ipv6_addr_t addr;           /**< own IP address */
+    ipv6_addr_t coordinator;    /**< IP address of (assumed) coordinator */
+    int16_t mean;               /**< aggregated sensor value */
+    elect_aggr_t aggr;          /**< aggregation of current round */
+    uint32_t obs_refresh;       /**< time of last observe registration in ms */
+    ipv6_addr_t standby;        /**< standby leader, unspecified if none */
+    uint32_t standby_sent;      /**< time of last standby announcement in ms */
+    unsigned sync_pos;          /**< next member to send to the standby */
+    uint16_t epoch;             /**< incremented on every takeover */
+    ipv6_addr_t handoff;        /**< node to fetch the members from, or that
+                                     they were fetched from, unspecified if none */
+    unsigned fetch_first;       /**< position of the block being fetched */
+    unsigned fetch_retries;     /**< requests left for it, 0 if none pending */
+    ipv6_addr_t reg_addr;       /**< node we register with as client */
+    uint32_t reg_timeout;       /**< timeout of the pending registration in ms,
+                                     0 once acknowledged */
+    uint32_t polled;            /**< time of last request of our value in ms */
+    elect_gossip_t gossip;      /**< adaptive broadcasts, if ELECT_GOSSIP */
+    elect_timing_t timing;      /**< adaptive intervals, if ELECT_TIMING */
+#if ELECT_GROUPS
+    ipv6_addr_t heads[ELECT_GROUPS];    /**< group heads, coordinator only */
+    int32_t part_sum;           /**< sum of values in current round */
+    uint16_t part_count;        /**< number of values in current round */
+#endif
+} elect_fsm_t;
+
+/**
+ * @brief Sensor sample as exchanged between nodes
+ */
+typedef struct {
+    uint32_t time;      /**< timestamp of the sample in ms */
+    uint16_t seq;       /**< sequence number of the sample */
+    int16_t value;      /**< sensor value, mean of partial aggregate if any */
+    uint16_t count;     /**< number of values in partial aggregate, or 0 */
+    int32_t sum;        /**< sum of values in partial aggregate */
+    uint32_t rtt;       /**< round trip time of the request in us, 0 if unknown */
+    ipv6_addr_t addr;   /**< IP address of the node the sample came from */
+} elect_sample_t;
+
+/**
+ * @brief Registration of a node, content of ELECT_NODES_EVENT
+ */
+typedef struct {
+    ipv6_addr_t node;   /**< IP address of the registering node */
+    ipv6_addr_t parent; /**< set by the coordinator to the node to register
+                             with instead, unspecified if none */
+    unsigned members;   /**< size of the membership table of the node */
+    bool renew;         /**< re-announce of a registered node */
+    uint16_t epoch;     /**< epoch of the leader known to a re-announcing node */
+    bool accepted;      /**< set by the coordinator if it registered the node,
+                             or redirected it */
+} elect_reg_t;
+
+/**
+ * @brief Announcement of the standby leader, content of ELECT_STANDBY_EVENT
+ */
+typedef struct {
+    uint16_t epoch;         /**< epoch of the leader */
+    ipv6_addr_t leader;     /**< IP address of the leader */
+    ipv6_addr_t standby;    /**< IP address of the standby, unspecified if none */
+} elect_standby_t;
+
+/**
+ * @brief Aggregate broadcast by the coordinator, content of
+ *        ELECT_AGGREGATE_EVENT
+ */
+typedef struct {
+    uint16_t epoch;         /**< epoch of the leader */
+    int16_t value;          /**< aggregated sensor value */
+    uint16_t interval;      /**< current interval of the leader in ms */
+    ipv6_addr_t leader;     /**< IP address of the leader */
+} elect_aggregate_t;
+
+/**
+ * @brief Chunk of the membership table, content of ELECT_SYNC_EVENT
+ */
+typedef struct {
+    unsigned num;                               /**< number of nodes */
+    ipv6_addr_t nodes[ELECT_STANDBY_CHUNK];     /**< IP addresses of members */
+} elect_sync_t;
+
+/**
+ * @brief Block of the membership table, content of ELECT_LIST_EVENT, which
+ *        asks main to fill it, and of ELECT_SEED_EVENT
+ */
+typedef struct {
+    ipv6_addr_t node;                       /**< node the block came from */
+    unsigned first;                         /**< position of the first node
+                                                 in the membership table */
+    unsigned num;                           /**< number of nodes, the max.
+                                                 number to fill in on
+                                                 ELECT_LIST_EVENT */
+    bool more;                              /**< further blocks follow */
+    bool lost;                              /**< the request timed out, on
+                                                 ELECT_SEED_EVENT only */
+    ipv6_addr_t nodes[ELECT_NODES_BLOCK];   /**< IP addresses of members */
+} elect_block_t;
+
+/**
+ * @brief Entry of the coordinator's membership table
+ *
+ * Members are identified by the interface ID of their link local address,
+ * as all of them share the prefix `fe80::/64`.
+ */
+typedef struct {
+    uint64_t iid;       /**< interface ID of the member */
+    uint32_t last_seen; /**< time of last contact in ms */
+    uint32_t time;      /**< timestamp of cached sample in ms */
+    int32_t sum;        /**< cached value, or sum of cached partial aggregate */
+    uint16_t count;     /**< number of values cached, 0 if none */
+    uint16_t seq;       /**< sequence number of cached sample */
+} elect_member_t;
+
+/**
+ * @brief Init CoAP handlers
+ *
+ * @param[in] main  process ID of main thread, needed for IPC
+ *
+ * @returns 0 on success, error otherwise
+ */
+int coap_init(kernel_pid_t main);
+
+/**
+ * @brief Start broadcast listener
+ *
+ * @returns 0 on success, error otherwise
+ */
+int listen_init(kernel_pid_t main);
+
+/**
+ * @brief Init network interface
+ *
+ * Set channel, TX power, PAN ID, IP addresses as necessary. Can be empty,
+ * if no specific configuration is required.
+ *
+ * @param[in] main  process ID of main thread, needed for IPC
+ *
+ * @returns 0 on success, error otherwise
+ */
+int net_init(kernel_pid_t main);
+
+/**
+ * @brief Init sensor and start sampling it every ELECT_SENSOR_PERIOD
+ *
+ * @returns 0 on success, error otherwise
+ */
+int sensor_init(void);
+
+/**
+ * @brief Get latest temperature sensor value
+ *
+ * Returns the value of the last sample taken in the background, thus never
+ * waits for the sensor.
+ *
+ * @returns Temperature value as degree Celsius x100
+ */
+int16_t sensor_read(void);
+
+/**
+ * @brief Send IP address via IPv6 multicast to `ff02::1`
+ *
+ * The address is sent as binary frame, link local addresses are reduced to
+ * their interface ID.
+ *
+ * @param[in] ip    IP address
+ *
+ * @returns 0 on success, or error otherwise
+ */
+int broadcast_id(const ipv6_addr_t *ip);
+
+/**
+ * @brief Send aggregate via IPv6 multicast to `ff02::2017`
+ *
+ * @param[in] epoch     epoch of the leader
+ * @param[in] leader    IP address of the leader
+ * @param[in] value     aggregated sensor value
+ * @param[in] interval  current interval of the leader in ms
+ *
+ * @returns 0 on success, or error otherwise
+ */
+int broadcast_sensor(uint16_t epoch, const ipv6_addr_t *leader, int16_t value,
+                     uint32_t interval);
+
+/**
+ * @brief Announce the standby leader via IPv6 multicast to `ff02::1`
+ *
+ * @param[in] epoch     epoch of the leader
+ * @param[in] leader    IP address of the leader
+ * @param[in] standby   IP address of the standby, unspecified if none
+ *
+ * @returns 0 on success, or error otherwise
+ */
+int broadcast_standby(uint16_t epoch, const ipv6_addr_t *leader,
+                      const ipv6_addr_t *standby);
+
+/**
+ * @brief Send IP address of node to leader node using CoAP PUT
+ *
+ * An acknowledgment is passed to the main thread as ELECT_REGISTERED_EVENT,
+ * a redirect to the head of a group as ELECT_PARENT_EVENT.
+ *
+ * @param[in] addr      IP address of leader node
+ * @param[in] node      IP address of local node
+ * @param[in] members   size of the membership table of the local node, the
+ *                      leader may fetch it if not 0
+ *
+ * @returns 0 on succes, error otherwise
+ */
+int coap_put_node(ipv6_addr_t addr, ipv6_addr_t node, unsigned members);
+
+/**
+ * @brief Re-announce node to the node it registered with, using a
+ *        non-confirmable CoAP PUT
+ *
+ * Sent from the broadcast listener without waiting for the response, the
+ * listener drops it.
+ *
+ * @param[in] addr      IP address of the node registered with
+ * @param[in] node      IP address of local node
+ * @param[in] members   size of the membership table of the local node
+ * @param[in] epoch     epoch of the leader known to the local node
+ *
+ * @returns 0 on success, error otherwise
+ */
+int coap_announce_node(ipv6_addr_t addr, ipv6_addr_t node, unsigned members,
+                       uint16_t epoch);
+
+/**
+ * @brief Fetch a block of the membership table of a node using CoAP GET
+ *
+ * The response is passed to the main thread as ELECT_SEED_EVENT.
+ *
+ * @param[in] addr  IP address of node
+ * @param[in] first position of the first member to fetch, a multiple of
+ *                  ELECT_NODES_BLOCK
+ *
+ * @returns 0 on success, error otherwise
+ */
+int coap_get_nodes(ipv6_addr_t addr, unsigned first);
+
+/**
+ * @brief Send members to the standby leader using CoAP PUT
+ *
+ * The standby passes them to its main thread as ELECT_SYNC_EVENT, which
+ * also shows it that the leader is alive, thus it is sent even if empty.
+ *
+ * @param[in] addr  IP address of standby
+ * @param[in] nodes IP addresses of members
+ * @param[in] num   number of members, at most ELECT_STANDBY_CHUNK
+ *
+ * @returns 0 on success, error otherwise
+ */
+int coap_put_standby(ipv6_addr_t addr, const ipv6_addr_t *nodes, unsigned num);
+
+/**
+ * @brief Get sensor reading from a node
+ *
+ * The response is passed to the main thread as ELECT_SENSOR_EVENT, followed
+ * by ELECT_POLL_DONE_EVENT once the request completed, also on timeout.
+ *
+ * @param[in] addr  IP address of node
+ *
+ * @returns 0 on success, error otherwise
+ */
+int coap_get_sensor(ipv6_addr_t addr);
+
+/**
+ * @brief Start a paced poll round over all members
+ *
+ * @param[in] interval  length of the round in ms
+ */
+void poll_start(uint32_t interval);
+
+/**
+ * @brief Handle ELECT_POLL_EVENT, send the next due request
+ */
+void poll_tick(void);
+
+/**
+ * @brief Handle completion (response or timeout) of a poll request
+ */
+void poll_done(void);
+
+/**
+ * @brief Stop polling, e.g. if node is no longer coordinator
+ */
+void poll_stop(void);
+
+/**
+ * @brief Get sensor readings of all nodes with a single group request
+ *
+ * Sends a non-confirmable CoAP GET to ELECT_COAP_GROUP_ADDR. Responses are
+ * received by the broadcast listener and passed to coap_recv_resp(). They
+ * carry no round trip time if members delay them, see ELECT_COAP_LEISURE.
+ *
+ * @returns 0 on success, error otherwise
+ */
+int coap_get_sensor_group(void);
+
+/**
+ * @brief Send the response to a group request, once its Leisure passed
+ *
+ * The sensor handler defers responses to group requests and sends an
+ * ELECT_LEISURE_EVENT to main after a random delay, see
+ * ELECT_COAP_LEISURE. The response is sent from the listener socket, as
+ * gcoap can not send it later.
+ *
+ * @param[in] addr  IP address of the coordinator, NULL to drop the response
+ *
+ * @returns 0 on success, error otherwise
+ */
+int coap_put_sensor_group(const ipv6_addr_t *addr);
+
+/**
+ * @brief Register as observer of the sensor resource of a node
+ *
+ * Sending the registration again refreshes it. Notifications are received
+ * by the broadcast listener and passed to coap_recv_resp().
+ *
+ * @param[in] addr  IP address of node
+ *
+ * @returns 0 on success, error otherwise
+ */
+int coap_observe_sensor(ipv6_addr_t addr);
+
+/**
+ * @brief Notify observer of the sensor resource, if required
+ *
+ * A notification is sent, if the sensor value changed by at least
+ * ELECT_OBS_DELTA or the last one is older than @p max_age.
+ *
+ * @param[in] max_age   max. time in ms between notifications,
+ *                      ELECT_OBS_MAX_AGE scaled to the leader's interval
+ *
+ * @returns 0 on success, error otherwise
+ */
+int coap_notify_sensor(uint32_t max_age);
+
+/**
+ * @brief Set partial aggregate of a group head, sent in sensor responses
+ *
+ * @param[in] sum       sum of values of the head and its members
+ * @param[in] count     number of values, 0 to send the own value only
+ */
+void coap_set_partial(int32_t sum, uint16_t count);
+
+/**
+ * @brief Set the latest aggregate of the coordinator, served at /aggregate
+ *
+ * @param[in] aggr      aggregate, with epoch and leader
+ */
+void coap_set_aggregate(const elect_aggregate_t *aggr);
+
+/**
+ * @brief Read the latest aggregate of the coordinator, without traffic
+ *
+ * @param[out] aggr     aggregate, with epoch and leader
+ * @param[out] age      time since it was set in ms
+ *
+ * @returns 0 on success, 1 if no aggregate is known yet
+ */
+int coap_read_aggregate(elect_aggregate_t *aggr, uint32_t *age);
+
+/**
+ * @brief Parse response to a request sent from the listener socket
+ *
+ * Accepts responses to the latest group request and sensor notifications.
+ *
+ * @param[in]  buf      received CoAP message
+ * @param[in]  len      length of @p buf
+ * @param[in]  remote   sender of the message
+ * @param[out] sample   sensor sample, attributed to the sending node
+ *
+ * @returns 0 on success, error otherwise
+ */
+int coap_recv_resp(uint8_t *buf, size_t len, const sock_udp_ep_t *remote,
+                   elect_sample_t *sample);
+
+/**
+ * @brief Return receive buffer of the listener, once main is done with it
+ *
+ * Content of ELECT_BROADCAST_EVENT, ELECT_SENSOR_EVENT, and
+ * ELECT_AGGREGATE_EVENT messages may be owned by the listener's buffer
+ * pool, other pointers are ignored.
+ *
+ * @param[in] ptr   content pointer of a message
+ *
+ * @returns 0 if a buffer was released, 1 if @p ptr is not pooled
+ */
+int listen_release(void *ptr);
+
+/**
+ * @brief Set the window in which the listener drops repeated node IDs
+ *
+ * @param[in] ms    window in ms, see ELECT_DEDUP_WINDOW
+ */
+void listen_dedup_window(uint32_t ms);
+
+/**
+ * @brief Send data from the socket of the broadcast listener
+ *
+ * Replies to the sent data are handled by the listener thread.
+ *
+ * @param[in] addr  destination IP address
+ * @param[in] port  destination port
+ * @param[in] data  data to send
+ * @param[in] len   length of @p data
+ *
+ * @returns number of bytes sent, or error (<0) otherwise
+ */
+int listen_send(const ipv6_addr_t *addr, uint16_t port,
+                const uint8_t *data, size_t len);
+
+/**
+ * @brief Get link local IP address as string of this node
+ *
+ * @param[out] addr     Node link local IP address as binary,
+ *                      IPV6_ADDR_UNSPECIFIED on error
+ */
+void get_node_ip_addr(ipv6_addr_t *addr);
+
+/**
+ * @brief Encode unsigned integer as CBOR
+ *
+ * @param[out] buf      target buffer
+ * @param[in]  len      size of @p buf
+ * @param[in]  val      value to encode
+ *
+ * @returns length of encoded value, 0 if @p buf is too small
+ */
+size_t codec_put_uint(uint8_t *buf, size_t len, uint32_t val);
+
+/**
+ * @brief Encode head of CBOR array, the items have to follow
+ *
+ * @param[out] buf      target buffer
+ * @param[in]  len      size of @p buf
+ * @param[in]  items    number of items in array
+ *
+ * @returns length of encoded head, 0 if @p buf is too small
+ */
+size_t codec_put_array(uint8_t *buf, size_t len, unsigned items);
+
+/**
+ * @brief Encode sensor sample as CBOR array `[value, time, seq]`, followed
+ *        by `sum, count` for partial aggregates
+ *
+ * @param[out] buf      target buffer
+ * @param[in]  len      size of @p buf
+ * @param[in]  sample   sample to encode
+ *
+ * @returns length of encoded sample, 0 if @p buf is too small
+ */
+size_t codec_put_sample(uint8_t *buf, size_t len, const elect_sample_t *sample);
+
+/**
+ * @brief Decode CBOR encoded sensor sample
+ *
+ * @param[in]  buf      encoded sample
+ * @param[in]  len      length of @p buf
+ * @param[out] sample   decoded sample
+ *
+ * @returns 0 on success, error otherwise
+ */
+int codec_get_sample(const uint8_t *buf, size_t len, elect_sample_t *sample);
+
+/**
+ * @brief Encode aggregate as CBOR array `[value, age, epoch, leader]`
+ *
+ * @param[out] buf      target buffer
+ * @param[in]  len      size of @p buf
+ * @param[in]  aggr     aggregate to encode, the leader as node
+ * @param[in]  age      age of the aggregate in ms
+ *
+ * @returns length of encoded aggregate, 0 if @p buf is too small
+ */
+size_t codec_put_aggregate(uint8_t *buf, size_t len,
+                           const elect_aggregate_t *aggr, uint32_t age);
+
+/**
+ * @brief Encode IP address of a node as CBOR byte string
+ *
+ * Link local addresses are reduced to their interface ID.
+ *
+ * @param[out] buf      target buffer
+ * @param[in]  len      size of @p buf
+ * @param[in]  addr     IP address to encode
+ *
+ * @returns length of encoded address, 0 if @p buf is too small
+ */
+size_t codec_put_node(uint8_t *buf, size_t len, const ipv6_addr_t *addr);
+
+/**
+ * @brief Decode CBOR encoded IP address of a node
+ *
+ * @param[in]  buf      encoded address
+ * @param[in]  len      length of @p buf
+ * @param[out] addr     decoded IP address
+ *
+ * @returns 0 on success, error otherwise
+ */
+int codec_get_node(const uint8_t *buf, size_t len, ipv6_addr_t *addr);
+
+/**
+ * @brief Encode registration of a node
+ *
+ * The IP address as of codec_put_node(), followed by the size of the
+ * membership table as unsigned integer if it is not 0, and by the epoch as
+ * unsigned integer for a re-announce.
+ *
+ * @param[out] buf      target buffer
+ * @param[in]  len      size of @p buf
+ * @param[in]  reg      registration to encode
+ *
+ * @returns length of encoded registration, 0 if @p buf is too small
+ */
+size_t codec_put_reg(uint8_t *buf, size_t len, const elect_reg_t *reg);
+
+/**
+ * @brief Decode registration of a node
+ *
+ * @param[in]  buf      encoded registration
+ * @param[in]  len      length of @p buf
+ * @param[out] reg      decoded registration, without parent and acceptance
+ *
+ * @returns 0 on success, error otherwise
+ */
+int codec_get_reg(const uint8_t *buf, size_t len, elect_reg_t *reg);
+
+/**
+ * @brief Encode IP addresses of nodes as CBOR array
+ *
+ * @param[out] buf      target buffer
+ * @param[in]  len      size of @p buf
+ * @param[in]  addrs    IP addresses
+ * @param[in]  num      number of addresses
+ *
+ * @returns number of bytes written, 0 if @p buf is too small
+ */
+size_t codec_put_nodes(uint8_t *buf, size_t len, const ipv6_addr_t *addrs,
+                       unsigned num);
+
+/**
+ * @brief Decode CBOR array of IP addresses of nodes
+ *
+ * @param[in]     buf   encoded addresses
+ * @param[in]     len   length of @p buf
+ * @param[out]    addrs decoded IP addresses
+ * @param[in,out] num   capacity of @p addrs, number of decoded addresses
+ *
+ * @returns 0 on success, error otherwise
+ */
+int codec_get_nodes(const uint8_t *buf, size_t len, ipv6_addr_t *addrs,
+                    unsigned *num);
+
+/**
+ * @brief Remove all members from membership table
+ */
+void members_clear(void);
+
+/**
+ * @brief Get number of members
+ *
+ * @returns number of members in table
+ */
+unsigned members_count(void);
+
+/**
+ * @brief Get member by position, for iteration over all members
+ *
+ * @note Removing a member may move another one into its position.
+ *
+ * @param[in] idx   position of member, must be less than members_count()
+ *
+ * @returns pointer to member, NULL if @p idx is out of range
+ */
+elect_member_t *members_get(unsigned idx);
+
+/**
+ * @brief Lookup member by IP address
+ *
+ * @param[in] addr  link local IP address of member
+ *
+ * @returns pointer to member, NULL if not found
+ */
+elect_member_t *members_find(const ipv6_addr_t *addr);
+
+/**
+ * @brief Add member, or lookup if it already exists
+ *
+ * @param[in]  addr     link local IP address of member
+ * @param[out] is_new   true, if member was added
+ *
+ * @returns pointer to member, NULL if table is full or address invalid
+ */
+elect_member_t *members_add(const ipv6_addr_t *addr, bool *is_new);
+
+/**
+ * @brief Remove member from table
+ *
+ * @param[in] addr  link local IP address of member
+ *
+ * @returns 0 on success, 1 if not found
+ */
+int members_remove(const ipv6_addr_t *addr);
+
+/**
+ * @brief Get link local IP address of member
+ *
+ * @param[in]  member   member entry
+ * @param[out] addr     link local IP address of member
+ */
+void members_addr(const elect_member_t *member, ipv6_addr_t *addr);
+
+/**
+ * @brief Add record to trace buffer, use ELECT_TRACE() instead
+ *
+ * @param[in] event     event ID, see ELECT_TRACE_*
+ * @param[in] arg0      first event argument
+ * @param[in] arg1      second event argument
+ */
+void trace_add(uint16_t event, uint16_t arg0, uint32_t arg1);
+
+/**
+ * @brief Dump newest trace records in chronological order
+ *
+ * Each record is 12 bytes in network byte order: timestamp in us (4),
+ * event ID (2), first (2) and second (4) argument.
+ *
+ * @param[out] buf  target buffer
+ * @param[in]  len  size of @p buf
+ *
+ * @returns number of bytes written
+ */
+size_t trace_dump(uint8_t *buf, size_t len);
+
+/**
+ * @brief Increment statistics counter
+ *
+ * @param[in] counter   counter, see ELECT_STATS_*
+ */
+void stats_inc(unsigned counter);
+
+/**
+ * @brief Record handling of an event by the main loop
+ *
+ * @param[in] type      message type of event
+ * @param[in] usec      time spent handling the event in us
+ * @param[in] queued    number of messages waiting in the queue
+ */
+void stats_event(uint16_t type, uint32_t usec, unsigned queued);
+
+/**
+ * @brief Record start of a poll round
+ *
+ * @param[in] members   number of members expected to respond
+ */
+void stats_round_start(unsigned members);
+
+/**
+ * @brief Record response of a member in current poll round
+ */
+void stats_round_resp(void);
+
+/**
+ * @brief Print counters and poll round latency as one line of `key=value`
+ *        pairs, as parsed by the benchmark harness
+ *
+ * @param[in] interval  interval in effect in ms, see fsm_interval()
+ */
+void stats_print(uint32_t interval);
+
+/**
+ * @brief Dump statistics as CBOR, or a part of them
+ *
+ * Format: `[[counters...], queue max, round, [[type, event], ...]]`,
+ * latencies are given as `[count, sum, max, histogram...]` in us. All
+ * events are listed and integers have a fixed width, thus the dump has the
+ * same length and layout every time, and parts of separate calls fit
+ * together.
+ *
+ * @param[out] buf      target buffer for the part
+ * @param[in]  len      size of @p buf
+ * @param[in]  offset   offset of the part in the dump
+ *
+ * @returns length of the whole dump, up to @p len bytes of it from
+ *          @p offset are written to @p buf
+ */
+size_t stats_dump(uint8_t *buf, size_t len, size_t offset);
+
+/**
+ * @brief Start adaptive broadcasts at the minimum interval
+ *
+ * @param[out] gossip   broadcast state
+ * @param[in]  best     highest node ID known
+ */
+void gossip_start(elect_gossip_t *gossip, const ipv6_addr_t *best);
+
+/**
+ * @brief Stop adaptive broadcasts
+ *
+ * @param[in,out] gossip    broadcast state
+ */
+void gossip_stop(elect_gossip_t *gossip);
+
+/**
+ * @brief Account a received node ID broadcast
+ *
+ * A higher ID than the best known one replaces it and restarts at the
+ * minimum interval, the best known ID counts towards suppression.
+ *
+ * @param[in,out] gossip    broadcast state
+ * @param[in]     id        received node ID
+ */
+void gossip_heard(elect_gossip_t *gossip, const ipv6_addr_t *id);
+
+/**
+ * @brief Handle ELECT_GOSSIP_EVENT, broadcast or start next interval
+ *
+ * @param[in,out] gossip    broadcast state
+ */
+void gossip_timer(elect_gossip_t *gossip);
+
+/**
+ * @brief Start aggregation with the own value
+ *
+ * @param[out] aggr     accumulator
+ * @param[in]  value    own sensor value
+ */
+void aggr_init(elect_aggr_t *aggr, int16_t value);
+
+/**
+ * @brief Start a new polling round with the own value
+ *
+ * Read the result of the previous round with aggr_value() before.
+ *
+ * @param[in,out] aggr  accumulator
+ * @param[in]     value own sensor value
+ */
+void aggr_round(elect_aggr_t *aggr, int16_t value);
+
+/**
+ * @brief Add a sample, partial aggregates count with all their values
+ *
+ * For ELECT_AGGR_LAST the sample replaces the one cached for @p member,
+ * unless it is a duplicate or older.
+ *
+ * @param[in,out] aggr      accumulator
+ * @param[in,out] member    member the sample came from
+ * @param[in]     sample    received sample
+ */
+void aggr_add(elect_aggr_t *aggr, elect_member_t *member,
+              const elect_sample_t *sample);
+
+/**
+ * @brief Drop the value cached for a member, for ELECT_AGGR_LAST
+ *
+ * @param[in,out] aggr      accumulator
+ * @param[in,out] member    member to drop the value of
+ */
+void aggr_drop(elect_aggr_t *aggr, elect_member_t *member);
+
+/**
+ * @brief Get the aggregate, rounded to the nearest integer
+ *
+ * @param[in] aggr  accumulator
+ *
+ * @returns aggregated sensor value
+ */
+int16_t aggr_value(const elect_aggr_t *aggr);
+
+/**
+ * @brief Forget all senders, and start with a window of ELECT_DEDUP_WINDOW
+ *
+ * @param[out] dedup    cache
+ */
+void dedup_init(elect_dedup_t *dedup);
+
+/**
+ * @brief Check a node ID for a repeat, and remember it otherwise
+ *
+ * The least recently passed on sender is replaced by a new one.
+ *
+ * @param[in,out] dedup     cache
+ * @param[in]     sender    interface ID of sender
+ * @param[in]     id        node ID received
+ * @param[in]     now       current time in ms
+ *
+ * @returns true if @p id repeats the last ID of @p sender within the
+ *          window, false if it is to be passed on
+ */
+bool dedup_check(elect_dedup_t *dedup, const uint8_t *sender,
+                 const ipv6_addr_t *id, uint32_t now);
+
+/**
+ * @brief Forget a sender, if its last ID could not be passed on
+ *
+ * @param[in,out] dedup     cache
+ * @param[in]     sender    interface ID of sender
+ */
+void dedup_forget(elect_dedup_t *dedup, const uint8_t *sender);
+
+/**
+ * @brief Init the deadlines of the timers of main
+ *
+ * @param[in] pid   thread to send ELECT_DEADLINE_EVENT to on wakeup
+ */
+void deadline_init(kernel_pid_t pid);
+
+/**
+ * @brief (Re)arm a timer, replacing its pending deadline
+ *
+ * @param[in] timer     timer, see ELECT_TIMER_*
+ * @param[in] offset    time until the deadline in ms
+ */
+void deadline_set(unsigned timer, uint32_t offset);
+
+/**
+ * @brief Disarm a timer
+ *
+ * @param[in] timer     timer, see ELECT_TIMER_*
+ */
+void deadline_stop(unsigned timer);
+
+/**
+ * @brief Get the next expired timer, after ELECT_DEADLINE_EVENT or any
+ *        other message of main
+ *
+ * Expired timers are returned in order of their deadlines and disarmed.
+ * Once none is left, the wakeup for the next pending deadline is set, unless
+ * the xtimer is still pending.
+ *
+ * @returns timer, see ELECT_TIMER_*, or -1 if no timer expired
+ */
+int deadline_next(void);
+
+/**
+ * @brief Init adaptive timing with the compile time parameters
+ *
+ * @param[out] timing   timing state
+ */
+void timing_init(elect_timing_t *timing);
+
+/**
+ * @brief Account the round trip time of a sensor request
+ *
+ * @param[in,out] timing    timing state
+ * @param[in]     usec      round trip time in us
+ */
+void timing_rtt(elect_timing_t *timing, uint32_t usec);
+
+/**
+ * @brief Note the start of an election
+ *
+ * @param[in,out] timing    timing state
+ */
+void timing_elect(elect_timing_t *timing);
+
+/**
+ * @brief Account a node ID higher than the known ones, while in election
+ *
+ * @param[in,out] timing    timing state
+ */
+void timing_heard(elect_timing_t *timing);
+
+/**
+ * @brief Note a new leader, before its first sign of life
+ *
+ * @param[in,out] timing    timing state
+ */
+void timing_leader(elect_timing_t *timing);
+
+/**
+ * @brief Account a sign of life (request or aggregate) of the leader, while
+ *        client
+ *
+ * @param[in,out] timing    timing state
+ */
+void timing_alive(elect_timing_t *timing);
+
+/**
+ * @brief Account the interval the leader announced with its aggregate
+ *
+ * The leader timeout spans at least as many of these intervals as
+ * ELECT_LEADER_TIMEOUT spans ELECT_MSG_INTERVAL, so a leader with a long
+ * interval is not taken for dead between its rounds.
+ *
+ * @param[in,out] timing    timing state
+ * @param[in]     ms        interval of the leader in ms
+ */
+void timing_leader_interval(elect_timing_t *timing, uint32_t ms);
+
+/**
+ * @brief Update the interval for a polling round
+ *
+ * @param[in,out] timing    timing state
+ * @param[in]     members   number of members to poll
+ *
+ * @returns interval in ms
+ */
+uint32_t timing_round(elect_timing_t *timing, unsigned members);
+
+/**
+ * @brief Scale a period given relative to ELECT_MSG_INTERVAL to the
+ *        current interval
+ *
+ * @param[in] timing    timing state
+ * @param[in] ms        period in ms
+ *
+ * @returns scaled period in ms
+ */
+uint32_t timing_scale(const elect_timing_t *timing, uint32_t ms);
+
+/**
+ * @brief Scale a period given relative to ELECT_MSG_INTERVAL to the
+ *        interval of the leader, or to the current one if that is longer
+ *
+ * For periods of a client that depend on the rounds of its leader, e.g. the
+ * re-announce of a registration, which would otherwise fire every round of
+ * a leader that stretched its interval.
+ *
+ * @param[in] timing    timing state
+ * @param[in] ms        period in ms
+ *
+ * @returns scaled period in ms
+ */
+uint32_t timing_leader_scale(const elect_timing_t *timing, uint32_t ms);
+
+/**
+ * @brief Get time after which a leader is identified
+ *
+ * @param[in] timing    timing state
+ *
+ * @returns leader threshold in ms
+ */
+uint32_t timing_threshold(const elect_timing_t *timing);
+
+/**
+ * @brief Get time after which a silent leader is dead
+ *
+ * @param[in] timing    timing state
+ *
+ * @returns leader timeout in ms
+ */
+uint32_t timing_timeout(const elect_timing_t *timing);
+
+/**
+ * @brief Init state machine and start the leader threshold timer
+ *
+ * The state machine depends on the functions declared here and on
+ * fsm_timer_set() and fsm_timer_stop() only, so that it runs on RIOT as
+ * well as in the host simulator.
+ *
+ * @param[out] fsm  state machine
+ * @param[in]  addr own IP address
+ */
+void fsm_init(elect_fsm_t *fsm, const ipv6_addr_t *addr);
+
+/**
+ * @brief Handle an event, see ELECT_*_EVENT
+ *
+ * @param[in,out] fsm       state machine
+ * @param[in]     type      event type
+ * @param[in]     content   content of event, depends on @p type
+ */
+void fsm_handle(elect_fsm_t *fsm, uint16_t type, void *content);
+
+/**
+ * @brief Get the interval in effect, own as coordinator, otherwise the one
+ *        of the leader if it is longer
+ *
+ * @param[in] fsm   state machine
+ *
+ * @returns interval in ms
+ */
+uint32_t fsm_interval(const elect_fsm_t *fsm);
+
+/**
+ * @brief (Re)start a timer of the state machine, provided by the platform
+ *
+ * @param[in] timer     timer, see ELECT_TIMER_*
+ * @param[in] offset    time until the timer fires in ms
+ */
+void fsm_timer_set(unsigned timer, uint32_t offset);
+
+/**
+ * @brief Stop a timer of the state machine, provided by the platform
+ *
+ * @param[in] timer     timer, see ELECT_TIMER_*
+ */
+void fsm_timer_stop(unsigned timer);
 
 /**
  * @brief Compare two IP addresses
@@ -0,0 +1,950 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       State machine of the leader election and aggregation
+ *
+ * Independent of RIOT's IPC and timers: events are passed in by the main
+ * loop, timers are (re)started via fsm_timer_set(). Thus the same code runs
+ * in the host simulator, see `sim/`.
+ *
+ * @}
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "log.h"
+#include "random.h"
+#include "xtimer.h"
+
+#include "elect.h"
+
+/**
+ * @brief   Names of states, as printed on state changes
+ */
+static const char *state_names[] = {
+    "DISCOVER", "ELECT", "CLIENT", "COORDINATOR"
+};
+
+/* --- internal helper functions --- */
+
+#if ELECT_GROUPS
+/**
+ * @brief Get group of a node, from a hash of its interface ID
+ */
+static unsigned _group(const ipv6_addr_t *addr)
+{
+    uint64_t iid;
+    memcpy(&iid, &addr->u8[ELECT_FRAME_IID_LEN], sizeof(iid));
+    return (unsigned)((iid * 0x9e3779b97f4a7c15ULL) >> 32) % ELECT_GROUPS;
+}
+
+/**
+ * @brief Start new aggregation round with own value
+ */
+static void _part_reset(elect_fsm_t *fsm, int16_t value)
+{
+    fsm->part_sum = value;
+    fsm->part_count = 1;
+}
+#endif
+
+/**
+ * @brief Drop cached values of members that were not heard of for
+ *        ELECT_AGGR_MAX_AGE
+ */
+static void _expire(elect_fsm_t *fsm)
+{
+    uint32_t now = xtimer_now_usec() / US_PER_MS;
+    uint32_t max_age = timing_scale(&fsm->timing, ELECT_AGGR_MAX_AGE);
+    for (unsigned i = 0; i < members_count(); i++) {
+        elect_member_t *member = members_get(i);
+        if ((member->count > 0) &&
+            ((now - member->last_seen) > max_age)) {
+            aggr_drop(&fsm->aggr, member);
+        }
+    }
+}
+
+/**
+ * @brief Get time after which the coordinator is considered dead
+ */
+static uint32_t _leader_timeout(const elect_fsm_t *fsm)
+{
+    if (ELECT_STANDBY && (ipv6_addr_cmp(&fsm->standby, &fsm->addr) == 0)) {
+        // standby takes over early, in the same ratio as configured
+        return (uint32_t)((uint64_t)timing_timeout(&fsm->timing) *
+                          ELECT_STANDBY_TIMEOUT / ELECT_LEADER_TIMEOUT);
+    }
+    return timing_timeout(&fsm->timing);
+}
+
+/**
+ * @brief Enter DISCOVER and announce own ID
+ */
+static void _discover(elect_fsm_t *fsm)
+{
+    fsm->coordinator = fsm->addr;
+    fsm->state = ELECT_STATE_DISCOVER;
+    timing_elect(&fsm->timing);
+    if (ELECT_GOSSIP) {
+        gossip_start(&fsm->gossip, &fsm->addr);
+    }
+    else {
+        fsm_timer_set(ELECT_TIMER_INTERVAL, fsm->timing.interval);
+    }
+}
+
+/**
+ * @brief Take the members in the table as registered with us, they get until
+ *        ELECT_LEADER_TIMEOUT to respond, before they are dropped, their
+ *        values are aggregated from scratch
+ */
+static void _adopt(void)
+{
+    uint32_t now = xtimer_now_usec() / US_PER_MS;
+    for (unsigned i = 0; i < members_count(); i++) {
+        elect_member_t *member = members_get(i);
+        member->last_seen = now;
+        member->count = 0;
+    }
+}
+
+/**
+ * @brief Get size of the membership table offered to the node we register
+ *        with, e.g. to a coordinator that won the election against us
+ */
+static unsigned _offer(void)
+{
+    return (ELECT_HANDOFF && !ELECT_GROUPS) ? members_count() : 0;
+}
+
+/**
+ * @brief Send registration to @p addr, and repeat it until acknowledged
+ */
+static void _reg_start(elect_fsm_t *fsm, const ipv6_addr_t *addr)
+{
+    fsm->reg_addr = *addr;
+    fsm->reg_timeout = timing_leader_scale(&fsm->timing, ELECT_REG_TIMEOUT);
+    fsm->polled = xtimer_now_usec() / US_PER_MS;
+    coap_put_node(fsm->reg_addr, fsm->addr, _offer());
+    // jitter keeps clients of a new coordinator from retrying in lockstep
+    fsm_timer_set(ELECT_TIMER_REGISTER, fsm->reg_timeout +
+                  random_uint32_range(0, fsm->reg_timeout / 4 + 1));
+}
+
+/**
+ * @brief Get time without poll before a registered client re-announces itself
+ */
+static uint32_t _announce_period(const elect_fsm_t *fsm)
+{
+    if (ELECT_TIMING && (fsm->timing.leader_interval == 0)) {
+        // no aggregate yet, the coordinator may use the longest interval
+        return (uint32_t)((uint64_t)ELECT_REG_ANNOUNCE *
+                          ELECT_TIMING_INTERVAL_MAX / ELECT_MSG_INTERVAL);
+    }
+    return timing_leader_scale(&fsm->timing, ELECT_REG_ANNOUNCE);
+}
+
+/**
+ * @brief Repeat an unacknowledged registration, or re-announce us if we were
+ *        not polled for ELECT_REG_ANNOUNCE
+ */
+static void _reg_timer(elect_fsm_t *fsm)
+{
+    if (fsm->state != ELECT_STATE_CLIENT) {
+        return;
+    }
+    uint32_t now = xtimer_now_usec() / US_PER_MS;
+    uint32_t announce = _announce_period(fsm);
+    uint32_t max = timing_leader_scale(&fsm->timing, ELECT_REG_TIMEOUT_MAX);
+    if (fsm->reg_timeout != 0) {
+        stats_inc(ELECT_STATS_REG_RETRY);
+        coap_put_node(fsm->reg_addr, fsm->addr, _offer());
+        fsm->reg_timeout *= 2;
+        if (fsm->reg_timeout > max) {
+            fsm->reg_timeout = max;
+        }
+        fsm_timer_set(ELECT_TIMER_REGISTER, fsm->reg_timeout +
+                      random_uint32_range(0, fsm->reg_timeout / 4 + 1));
+        return;
+    }
+    if ((now - fsm->polled) >= announce) {
+        // the node we registered with may have lost us, e.g. on a takeover
+        stats_inc(ELECT_STATS_REG_RETRY);
+        coap_announce_node(fsm->reg_addr, fsm->addr, _offer(), fsm->epoch);
+        fsm->polled = now;
+    }
+    fsm_timer_set(ELECT_TIMER_REGISTER, announce - (now - fsm->polled));
+}
+
+/**
+ * @brief Register with the coordinator as client
+ */
+static void _register(elect_fsm_t *fsm)
+{
+    _reg_start(fsm, &fsm->coordinator);
+    timing_leader(&fsm->timing);
+    fsm_timer_set(ELECT_TIMER_LEADER_TIMEOUT, _leader_timeout(fsm));
+#if ELECT_GROUPS
+    // members register again, if we become head of a group
+    members_clear();
+    coap_set_partial(0, 0);
+#endif
+    if ((ELECT_POLL_MODE == ELECT_POLL_OBSERVE) || ELECT_GROUPS) {
+        // periodically check if the observer must be notified, or
+        // poll members as group head
+        fsm_timer_set(ELECT_TIMER_INTERVAL, fsm->timing.interval);
+    }
+}
+
+#if ELECT_STANDBY
+/**
+ * @brief Announce the standby, or that there is none, to all nodes
+ */
+static void _announce(elect_fsm_t *fsm)
+{
+    fsm->standby_sent = xtimer_now_usec() / US_PER_MS;
+    broadcast_standby(fsm->epoch, &fsm->addr, &fsm->standby);
+}
+
+/**
+ * @brief Choose the highest live member as standby if the current one is
+ *        gone, announce it, and send it the next chunk of members
+ */
+static void _standby_interval(elect_fsm_t *fsm)
+{
+    uint32_t now = xtimer_now_usec() / US_PER_MS;
+    uint32_t timeout = timing_scale(&fsm->timing, ELECT_LEADER_TIMEOUT);
+    elect_member_t *member = NULL;
+    if (!ipv6_addr_is_unspecified(&fsm->standby)) {
+        member = members_find(&fsm->standby);
+    }
+    if ((member == NULL) || ((now - member->last_seen) > timeout)) {
+        ipv6_addr_set_unspecified(&fsm->standby);
+        for (unsigned i = 0; i < members_count(); i++) {
+            ipv6_addr_t addr;
+            member = members_get(i);
+            members_addr(member, &addr);
+            if (((now - member->last_seen) <= timeout) &&
+                (ipv6_addr_cmp(&addr, &fsm->standby) > 0)) {
+                fsm->standby = addr;
+            }
+        }
+        _announce(fsm);
+    }
+    else if ((now - fsm->standby_sent) >=
+             timing_scale(&fsm->timing, ELECT_STANDBY_ANNOUNCE)) {
+        _announce(fsm);
+    }
+    if (ipv6_addr_is_unspecified(&fsm->standby)) {
+        return;
+    }
+    // members of groups register with the standby after a takeover, as
+    // its membership table is in use for its own group
+    ipv6_addr_t chunk[ELECT_STANDBY_CHUNK];
+    unsigned num = 0;
+    while (!ELECT_GROUPS && (num < ELECT_STANDBY_CHUNK) &&
+           (num < members_count())) {
+        if (fsm->sync_pos >= members_count()) {
+            fsm->sync_pos = 0;
+        }
+        members_addr(members_get(fsm->sync_pos++), &chunk[num++]);
+    }
+    coap_put_standby(fsm->standby, chunk, num);
+}
+
+/**
+ * @brief Take over as coordinator, with the members sent by the leader
+ */
+static void _takeover(elect_fsm_t *fsm)
+{
+    LOG_DEBUG("\n\nSTANDBY TAKES OVER\n\n");
+    poll_stop();
+    fsm->state = ELECT_STATE_COORDINATOR;
+    fsm->coordinator = fsm->addr;
+    fsm->epoch++;
+    ipv6_addr_set_unspecified(&fsm->standby);
+#if ELECT_GROUPS
+    members_clear();
+    memset(fsm->heads, 0, sizeof(fsm->heads));
+    coap_set_partial(0, 0);
+#endif
+    _adopt();
+    fsm->handoff = fsm->addr;
+    fsm->mean = sensor_read();
+    aggr_init(&fsm->aggr, fsm->mean);
+    // poll right away, the first interval announces the new leader
+    fsm_timer_set(ELECT_TIMER_INTERVAL, 0);
+}
+
+/**
+ * @brief Handle a standby announcement
+ */
+static void _standby(elect_fsm_t *fsm, const elect_standby_t *ann)
+{
+    bool newer = ((int16_t)(ann->epoch - fsm->epoch) > 0);
+    if (fsm->state == ELECT_STATE_COORDINATOR) {
+        if ((ipv6_addr_cmp(&ann->leader, &fsm->addr) == 0) ||
+            (!newer && (ann->epoch != fsm->epoch))) {
+            return;
+        }
+        if (ipv6_addr_cmp(&fsm->addr, &ann->leader) > 0) {
+            // standby took over, but we are alive: claim clients back
+            fsm->epoch = ann->epoch + 1;
+            _announce(fsm);
+            return;
+        }
+        // yield to the other leader
+        poll_stop();
+        fsm->state = ELECT_STATE_CLIENT;
+        fsm->coordinator = ann->leader;
+        fsm->epoch = ann->epoch;
+        fsm->standby = ann->standby;
+        _register(fsm);
+        return;
+    }
+    if (fsm->state != ELECT_STATE_CLIENT) {
+        return;
+    }
+    if (ipv6_addr_cmp(&ann->leader, &fsm->coordinator) != 0) {
+        if (!newer) {
+            return;
+        }
+        // leader changed without election, register with it
+        fsm->coordinator = ann->leader;
+        fsm->epoch = ann->epoch;
+        fsm->standby = ann->standby;
+        _register(fsm);
+        return;
+    }
+    bool was_standby = (ipv6_addr_cmp(&fsm->standby, &fsm->addr) == 0);
+    fsm->epoch = ann->epoch;
+    fsm->standby = ann->standby;
+    if (!ELECT_GROUPS && !was_standby &&
+        (ipv6_addr_cmp(&fsm->standby, &fsm->addr) == 0)) {
+        // members are sent by the leader from now on
+        members_clear();
+    }
+    fsm_timer_set(ELECT_TIMER_LEADER_TIMEOUT, _leader_timeout(fsm));
+}
+
+/**
+ * @brief Handle members sent by the leader to us as standby
+ */
+static void _sync(elect_fsm_t *fsm, const elect_sync_t *sync)
+{
+    if (fsm->state != ELECT_STATE_CLIENT) {
+        return;
+    }
+    if (ipv6_addr_cmp(&fsm->standby, &fsm->addr) != 0) {
+        // announcement was lost
+        fsm->standby = fsm->addr;
+        if (!ELECT_GROUPS) {
+            members_clear();
+        }
+    }
+    uint32_t now = xtimer_now_usec() / US_PER_MS;
+    for (unsigned i = 0; i < sync->num; i++) {
+        bool added;
+        elect_member_t *member;
+        if ((ipv6_addr_cmp(&sync->nodes[i], &fsm->addr) != 0) &&
+            ((member = members_add(&sync->nodes[i], &added)) != NULL)) {
+            member->last_seen = now;
+        }
+    }
+    // only the leader sends members, thus it is alive
+    fsm_timer_set(ELECT_TIMER_LEADER_TIMEOUT, _leader_timeout(fsm));
+}
+#endif
+
+/**
+ * @brief Fill a block of the membership table, for `GET /nodes`
+ */
+static void _list(elect_block_t *blk)
+{
+    unsigned max = blk->num;
+    blk->num = 0;
+    // members of a group head are no members of the coordinator
+    while (!ELECT_GROUPS && (blk->num < max) &&
+           ((blk->first + blk->num) < members_count())) {
+        members_addr(members_get(blk->first + blk->num),
+                     &blk->nodes[blk->num]);
+        blk->num++;
+    }
+    blk->more = !ELECT_GROUPS && ((blk->first + blk->num) < members_count());
+}
+
+/**
+ * @brief Fetch the members of @p node, as new coordinator
+ */
+static void _fetch(elect_fsm_t *fsm, const ipv6_addr_t *node)
+{
+    fsm->handoff = *node;
+    fsm->fetch_first = 0;
+    fsm->fetch_retries = ELECT_NODES_RETRIES;
+    coap_get_nodes(*node, 0);
+}
+
+/**
+ * @brief Add a block of members of the node we fetch them from, and fetch
+ *        the next one
+ */
+static void _seed(elect_fsm_t *fsm, const elect_block_t *blk)
+{
+    if (fsm->state != ELECT_STATE_COORDINATOR) {
+        return;
+    }
+    if (blk->lost) {
+        // the node is not known on timeout, only one block is pending
+        if ((fsm->fetch_retries > 0) &&
+            !ipv6_addr_is_unspecified(&fsm->handoff)) {
+            fsm->fetch_retries--;
+            coap_get_nodes(fsm->handoff, fsm->fetch_first);
+        }
+        return;
+    }
+    if (ipv6_addr_cmp(&blk->node, &fsm->handoff) != 0) {
+        return;
+    }
+    fsm->fetch_retries = 0;
+    uint32_t now = xtimer_now_usec() / US_PER_MS;
+    bool announce = false;
+    for (unsigned i = 0; i < blk->num; i++) {
+        const ipv6_addr_t *node = &blk->nodes[i];
+        bool added;
+        elect_member_t *member;
+        if ((ipv6_addr_cmp(node, &fsm->addr) == 0) ||
+            ((member = members_add(node, &added)) == NULL) || !added) {
+            continue;
+        }
+        // like registered, until ELECT_LEADER_TIMEOUT passes without reply
+        member->last_seen = now;
+        if (ELECT_POLL_MODE == ELECT_POLL_OBSERVE) {
+            coap_observe_sensor(*node);
+        }
+        if (ELECT_STANDBY && (ipv6_addr_cmp(node, &fsm->standby) > 0)) {
+            fsm->standby = *node;
+            announce = true;
+        }
+    }
+    LOG_DEBUG("%s: %u member(s) after block at %u\n", __func__,
+              members_count(), blk->first);
+#if ELECT_STANDBY
+    if (announce) {
+        _announce(fsm);
+    }
+#else
+    (void)announce;
+#endif
+    // blocks of other sizes than ours would not line up with the next one
+    if (blk->more && (blk->num == ELECT_NODES_BLOCK)) {
+        fsm->fetch_first = blk->first + blk->num;
+        fsm->fetch_retries = ELECT_NODES_RETRIES;
+        coap_get_nodes(blk->node, fsm->fetch_first);
+    }
+}
+
+/**
+ * @brief Publish the aggregate, locally and to all clients
+ */
+static void _publish(elect_fsm_t *fsm)
+{
+    elect_aggregate_t aggr = {
+        .epoch = fsm->epoch, .value = fsm->mean,
+        .interval = (uint16_t)fsm->timing.interval, .leader = fsm->addr,
+    };
+    coap_set_aggregate(&aggr);
+    broadcast_sensor(fsm->epoch, &fsm->addr, fsm->mean, fsm->timing.interval);
+}
+
+static void _interval(elect_fsm_t *fsm)
+{
+    if ((fsm->state == ELECT_STATE_DISCOVER) && !ELECT_GOSSIP) {
+        broadcast_id(&fsm->addr);
+        fsm_timer_set(ELECT_TIMER_INTERVAL, fsm->timing.interval);
+    }
+    else if (fsm->state == ELECT_STATE_COORDINATOR) {
+        uint32_t interval = timing_round(&fsm->timing, members_count());
+        listen_dedup_window(timing_scale(&fsm->timing, ELECT_DEDUP_WINDOW));
+        if (ELECT_AGGR_MODE == ELECT_AGGR_LAST) {
+            _expire(fsm);
+        }
+        if (ELECT_AGGR_MODE != ELECT_AGGR_EWMA) {
+            // publish result of the round that just ended
+            fsm->mean = aggr_value(&fsm->aggr);
+            _publish(fsm);
+        }
+        // start new round with own value
+        aggr_round(&fsm->aggr, sensor_read());
+        // Query all clients for their sensor value
+        LOG_DEBUG("\n\n\nStarting Query...\n");
+        if (ELECT_POLL_MODE != ELECT_POLL_OBSERVE) {
+            stats_round_start(members_count());
+        }
+        if (ELECT_POLL_MODE == ELECT_POLL_GROUP) {
+            coap_get_sensor_group();
+        }
+        else if (ELECT_POLL_MODE == ELECT_POLL_OBSERVE) {
+            // clients push values, refresh registrations only
+            uint32_t now = xtimer_now_usec() / US_PER_MS;
+            if ((now - fsm->obs_refresh) >=
+                timing_scale(&fsm->timing, ELECT_OBS_REFRESH)) {
+                fsm->obs_refresh = now;
+                for (unsigned i = 0; i < members_count(); i++) {
+                    ipv6_addr_t client;
+                    members_addr(members_get(i), &client);
+                    coap_observe_sensor(client);
+                }
+            }
+        }
+        else {
+            // requests are spread across the interval
+            poll_start(interval);
+        }
+        LOG_DEBUG("Query done.\n\n\n");
+#if ELECT_STANDBY
+        _standby_interval(fsm);
+#endif
+        fsm_timer_set(ELECT_TIMER_INTERVAL, interval);
+    }
+    else if ((fsm->state == ELECT_STATE_CLIENT) &&
+             ((ELECT_POLL_MODE == ELECT_POLL_OBSERVE) || ELECT_GROUPS)) {
+        if (ELECT_POLL_MODE == ELECT_POLL_OBSERVE) {
+            // push sensor value to coordinator, if changed
+            coap_notify_sensor(timing_leader_scale(&fsm->timing,
+                                                   ELECT_OBS_MAX_AGE));
+        }
+#if ELECT_GROUPS
+        if (members_count() > 0) {
+            // group head: publish last round, then poll own members
+            coap_set_partial(fsm->part_sum, fsm->part_count);
+            _part_reset(fsm, sensor_read());
+            poll_start(timing_round(&fsm->timing, members_count()));
+            listen_dedup_window(timing_scale(&fsm->timing,
+                                             ELECT_DEDUP_WINDOW));
+        }
+#endif
+        fsm_timer_set(ELECT_TIMER_INTERVAL, fsm->timing.interval);
+    }
+}
+
+static void _broadcast(elect_fsm_t *fsm, const ipv6_addr_t *received,
+                       bool relayed)
+{
+    if (ELECT_GOSSIP && ((fsm->state == ELECT_STATE_DISCOVER) ||
+                         (fsm->state == ELECT_STATE_ELECT))) {
+        gossip_heard(&fsm->gossip, received);
+    }
+    if (fsm->state == ELECT_STATE_DISCOVER) {
+        if (ipv6_addr_cmp(&fsm->addr, received) < 0) {
+            // received bigger IP ==> stop broadcasting
+            fsm->state = ELECT_STATE_ELECT;
+            fsm->coordinator = *received;
+            timing_heard(&fsm->timing);
+            fsm_timer_stop(ELECT_TIMER_INTERVAL);
+            fsm_timer_set(ELECT_TIMER_LEADER_THRESHOLD,
+                          timing_threshold(&fsm->timing));
+        }
+    }
+    else if (fsm->state == ELECT_STATE_ELECT) {
+        int result = ipv6_addr_cmp(&fsm->coordinator, received);
+        if (result != 0) {
+            if (result < 0) {
+                // change coordinator
+                fsm->coordinator = *received;
+                timing_heard(&fsm->timing);
+            }
+            // IP changed, restart threshold
+            fsm_timer_set(ELECT_TIMER_LEADER_THRESHOLD,
+                          timing_threshold(&fsm->timing));
+        }
+    }
+    else {
+        if (relayed && (ipv6_addr_cmp(&fsm->coordinator, received) == 0)) {
+            // late gossip of the election result, nothing changed
+            return;
+        }
+        // someone joined or something
+        poll_stop();
+        // our coordinator is alive, if we win it hands its members over
+        if (fsm->state == ELECT_STATE_CLIENT) {
+            fsm->handoff = fsm->coordinator;
+        }
+        else {
+            ipv6_addr_set_unspecified(&fsm->handoff);
+        }
+        if (ipv6_addr_cmp(&fsm->addr, received) < 0) {
+            fsm->coordinator = *received;
+            fsm->state = ELECT_STATE_ELECT;
+            timing_elect(&fsm->timing);
+            fsm_timer_set(ELECT_TIMER_LEADER_THRESHOLD,
+                          timing_threshold(&fsm->timing));
+            if (ELECT_GOSSIP) {
+                gossip_start(&fsm->gossip, received);
+            }
+        }
+        else {
+            _discover(fsm);
+            fsm_timer_set(ELECT_TIMER_LEADER_THRESHOLD,
+                          timing_threshold(&fsm->timing));
+        }
+    }
+}
+
+static void _threshold(elect_fsm_t *fsm)
+{
+    if ((fsm->state != ELECT_STATE_DISCOVER) &&
+        (fsm->state != ELECT_STATE_ELECT)) {
+        return;
+    }
+    if (ELECT_GOSSIP) {
+        gossip_stop(&fsm->gossip);
+    }
+    ipv6_addr_set_unspecified(&fsm->standby);
+    fsm->sync_pos = 0;
+    if (ipv6_addr_cmp(&fsm->addr, &fsm->coordinator) == 0) {
+        // we are coordinator
+        fsm->state = ELECT_STATE_COORDINATOR;
+        LOG_DEBUG("\n\nWE ARE COORDINATOR\n\n");
+        if (ELECT_HANDOFF && !ELECT_GROUPS) {
+            // members of our last term, or sent to us as standby, are likely
+            // still around, fetch those of the former coordinator too
+            _adopt();
+            if (!ipv6_addr_is_unspecified(&fsm->handoff)) {
+                _fetch(fsm, &fsm->handoff);
+            }
+        }
+        else {
+            members_clear();
+        }
+        fsm->mean = sensor_read();
+        aggr_init(&fsm->aggr, fsm->mean);
+#if ELECT_GROUPS
+        memset(fsm->heads, 0, sizeof(fsm->heads));
+        coap_set_partial(0, 0);
+#endif
+        fsm_timer_set(ELECT_TIMER_INTERVAL, fsm->timing.interval);
+    }
+    else {
+        // we are client
+        fsm->state = ELECT_STATE_CLIENT;
+        ipv6_addr_set_unspecified(&fsm->handoff);
+        if (LOG_LEVEL >= LOG_DEBUG) {
+            char addr_str[IPV6_ADDR_MAX_STR_LEN];
+            ipv6_addr_to_str(addr_str, &fsm->coordinator, sizeof(addr_str));
+            LOG_DEBUG("\n\nWE ARE CLIENT\nCoordinator is %s\n\n", addr_str);
+        }
+        _register(fsm);
+    }
+}
+
+static void _nodes(elect_fsm_t *fsm, elect_reg_t *reg)
+{
+    if (fsm->state == ELECT_STATE_DISCOVER) {
+        // a client decided on us before our threshold expired, thresholds
+        // differ between nodes as they adapt to what each one observed
+        _threshold(fsm);
+    }
+    if ((fsm->state != ELECT_STATE_COORDINATOR) &&
+        !(ELECT_GROUPS && (fsm->state == ELECT_STATE_CLIENT))) {
+        // not accepted, the node tries again
+        return;
+    }
+#if ELECT_GROUPS
+    if (fsm->state == ELECT_STATE_COORDINATOR) {
+        ipv6_addr_t *head = &fsm->heads[_group(&reg->node)];
+        if (ipv6_addr_cmp(head, &reg->node) != 0) {
+            elect_member_t *member = members_find(head);
+            uint32_t now = xtimer_now_usec() / US_PER_MS;
+            if ((member != NULL) &&
+                ((now - member->last_seen) <
+                 timing_scale(&fsm->timing, ELECT_LEADER_TIMEOUT))) {
+                // group has a live head, node registers there
+                reg->parent = *head;
+                reg->accepted = true;
+                return;
+            }
+            // first node of group, or head died: node becomes head
+            if (member != NULL) {
+                aggr_drop(&fsm->aggr, member);
+                members_remove(head);
+            }
+            *head = reg->node;
+        }
+    }
+#endif
+    const ipv6_addr_t *node = &reg->node;
+    bool added;
+    elect_member_t *client = members_add(node, &added);
+    if (client == NULL) {
+        LOG_WARNING("client rejected, %u clients registered\n",
+                    members_count());
+        return;
+    }
+    client->last_seen = xtimer_now_usec() / US_PER_MS;
+    reg->accepted = true;
+    // node (re)started, its sequence numbers start over, unless it only
+    // re-announces itself within the same epoch
+    if ((fsm->state == ELECT_STATE_COORDINATOR) &&
+        (added || !reg->renew || (reg->epoch != fsm->epoch))) {
+        aggr_drop(&fsm->aggr, client);
+    }
+    if (added) {
+        LOG_DEBUG("\n\nADDED client #%u\n\n", members_count());
+    }
+#if ELECT_STANDBY
+    if ((fsm->state == ELECT_STATE_COORDINATOR) &&
+        (ipv6_addr_cmp(node, &fsm->standby) > 0)) {
+        fsm->standby = *node;
+        _announce(fsm);
+    }
+#endif
+    if (ELECT_POLL_MODE == ELECT_POLL_OBSERVE) {
+        coap_observe_sensor(*node);
+    }
+    if (ELECT_HANDOFF && !ELECT_GROUPS &&
+        (fsm->state == ELECT_STATE_COORDINATOR) && (reg->members > 0) &&
+        ipv6_addr_is_unspecified(&fsm->handoff)) {
+        // e.g. the former coordinator, it lost the election to us
+        _fetch(fsm, node);
+    }
+}
+
+/**
+ * @brief Handle an aggregate broadcast, a sign of life of our coordinator
+ */
+static void _aggregate(elect_fsm_t *fsm, const elect_aggregate_t *aggr)
+{
+    if ((fsm->state != ELECT_STATE_CLIENT) ||
+        (ipv6_addr_cmp(&aggr->leader, &fsm->coordinator) != 0) ||
+        ((int16_t)(aggr->epoch - fsm->epoch) < 0)) {
+        return;
+    }
+    timing_leader_interval(&fsm->timing, aggr->interval);
+    timing_alive(&fsm->timing);
+    fsm_timer_set(ELECT_TIMER_LEADER_TIMEOUT, _leader_timeout(fsm));
+    coap_set_aggregate(aggr);
+}
+
+static void _sensor(elect_fsm_t *fsm, const elect_sample_t *sample)
+{
+    if ((fsm->state != ELECT_STATE_COORDINATOR) &&
+        !(ELECT_GROUPS && (fsm->state == ELECT_STATE_CLIENT))) {
+        return;
+    }
+    elect_member_t *client = members_find(&sample->addr);
+    if ((client == NULL) && !ELECT_GROUPS &&
+        (fsm->state == ELECT_STATE_COORDINATOR)) {
+        // a client answering our group request takes itself as registered,
+        // it would not re-announce itself as it is polled
+        elect_reg_t reg = {
+            .node = sample->addr, .members = 0, .renew = true,
+            .epoch = fsm->epoch, .accepted = false,
+        };
+        _nodes(fsm, &reg);
+        client = members_find(&sample->addr);
+    }
+    if (client == NULL) {
+        // reply of a node that is not registered
+        return;
+    }
+    client->last_seen = xtimer_now_usec() / US_PER_MS;
+    timing_rtt(&fsm->timing, sample->rtt);
+#if ELECT_GROUPS
+    if (fsm->state == ELECT_STATE_CLIENT) {
+        // group head, partial aggregates of heads below count with all values
+        fsm->part_sum += sample->count ? sample->sum : sample->value;
+        fsm->part_count += sample->count ? sample->count : 1;
+        return;
+    }
+#endif
+    stats_round_resp();
+    aggr_add(&fsm->aggr, client, sample);
+    if (ELECT_AGGR_MODE == ELECT_AGGR_EWMA) {
+        fsm->mean = aggr_value(&fsm->aggr);
+        LOG_DEBUG("\n\nmean=%i, value=%i\n\n", fsm->mean, sample->value);
+        _publish(fsm);
+    }
+}
+
+/* --- public interface functions --- */
+
+void fsm_init(elect_fsm_t *fsm, const ipv6_addr_t *addr)
+{
+    fsm->state = ELECT_STATE_DISCOVER;
+    fsm->addr = *addr;
+    // assume we are coordinator
+    fsm->coordinator = *addr;
+    fsm->mean = 0;
+    aggr_init(&fsm->aggr, 0);
+    fsm->obs_refresh = 0;
+    ipv6_addr_set_unspecified(&fsm->standby);
+    fsm->standby_sent = 0;
+    fsm->sync_pos = 0;
+    fsm->epoch = 0;
+    ipv6_addr_set_unspecified(&fsm->handoff);
+    fsm->fetch_first = 0;
+    fsm->fetch_retries = 0;
+    ipv6_addr_set_unspecified(&fsm->reg_addr);
+    fsm->reg_timeout = 0;
+    fsm->polled = 0;
+    timing_init(&fsm->timing);
+    timing_elect(&fsm->timing);
+    if (ELECT_GOSSIP) {
+        gossip_start(&fsm->gossip, addr);
+    }
+    fsm_timer_set(ELECT_TIMER_LEADER_THRESHOLD, timing_threshold(&fsm->timing));
+}
+
+uint32_t fsm_interval(const elect_fsm_t *fsm)
+{
+    if (fsm->state == ELECT_STATE_COORDINATOR) {
+        return fsm->timing.interval;
+    }
+    return timing_leader_scale(&fsm->timing, ELECT_MSG_INTERVAL);
+}
+
+void fsm_handle(elect_fsm_t *fsm, uint16_t type, void *content)
+{
+    elect_state_t prev = fsm->state;
+    switch (type) {
+        case ELECT_INTERVAL_EVENT:
+            LOG_DEBUG("+ interval event.\n");
+            _interval(fsm);
+            break;
+        case ELECT_BROADCAST_EVENT:
+            LOG_DEBUG("+ broadcast event.\n");
+            _broadcast(fsm, content, false);
+            break;
+        case ELECT_RELAY_EVENT:
+            LOG_DEBUG("+ relay event.\n");
+            _broadcast(fsm, content, true);
+            break;
+        case ELECT_GOSSIP_EVENT:
+            if ((fsm->state == ELECT_STATE_DISCOVER) ||
+                (fsm->state == ELECT_STATE_ELECT)) {
+                gossip_timer(&fsm->gossip);
+            }
+            break;
+        case ELECT_LEADER_ALIVE_EVENT:
+            LOG_DEBUG("+ leader event.\n");
+            if (fsm->state == ELECT_STATE_CLIENT) {
+                timing_alive(&fsm->timing);
+                fsm->polled = xtimer_now_usec() / US_PER_MS;
+            }
+            fsm_timer_set(ELECT_TIMER_LEADER_TIMEOUT, _leader_timeout(fsm));
+            break;
+        case ELECT_AGGREGATE_EVENT:
+            LOG_DEBUG("+ aggregate event.\n");
+            _aggregate(fsm, content);
+            break;
+        case ELECT_LEADER_TIMEOUT_EVENT:
+            LOG_DEBUG("+ leader timeout event.\n");
+#if ELECT_STANDBY
+            if ((fsm->state == ELECT_STATE_CLIENT) &&
+                !ipv6_addr_is_unspecified(&fsm->standby)) {
+                if (ipv6_addr_cmp(&fsm->standby, &fsm->addr) == 0) {
+                    _takeover(fsm);
+                }
+                else {
+                    // register with the standby, an election follows if
+                    // it did not take over either
+                    fsm->coordinator = fsm->standby;
+                    ipv6_addr_set_unspecified(&fsm->standby);
+                    _register(fsm);
+                }
+                break;
+            }
+#endif
+            if (fsm->state == ELECT_STATE_CLIENT) {
+                // coordinator died
+                ipv6_addr_set_unspecified(&fsm->handoff);
+                _discover(fsm);
+                fsm_timer_set(ELECT_TIMER_LEADER_THRESHOLD,
+                              timing_threshold(&fsm->timing));
+            }
+            break;
+        case ELECT_NODES_EVENT:
+            LOG_DEBUG("+ nodes event.\n");
+            _nodes(fsm, content);
+            break;
+        case ELECT_PARENT_EVENT:
+            LOG_DEBUG("+ parent event.\n");
+            if ((fsm->state == ELECT_STATE_CLIENT) &&
+                (ipv6_addr_cmp(&fsm->addr, content) != 0)) {
+                // coordinator redirected us to the head of our group
+                _reg_start(fsm, content);
+                timing_leader(&fsm->timing);
+            }
+            break;
+        case ELECT_REGISTER_EVENT:
+            LOG_DEBUG("+ register event.\n");
+            _reg_timer(fsm);
+            break;
+        case ELECT_REGISTERED_EVENT:
+            LOG_DEBUG("+ registered event.\n");
+            if ((fsm->state == ELECT_STATE_CLIENT) &&
+                (fsm->reg_timeout != 0) &&
+                (ipv6_addr_cmp(&fsm->reg_addr, content) == 0)) {
+                fsm->reg_timeout = 0;
+                fsm_timer_set(ELECT_TIMER_REGISTER, _announce_period(fsm));
+            }
+            break;
+#if ELECT_STANDBY
+        case ELECT_STANDBY_EVENT:
+            LOG_DEBUG("+ standby event.\n");
+            _standby(fsm, content);
+            break;
+        case ELECT_SYNC_EVENT:
+            LOG_DEBUG("+ sync event.\n");
+            _sync(fsm, content);
+            break;
+#endif
+        case ELECT_LIST_EVENT:
+            LOG_DEBUG("+ list event.\n");
+            _list(content);
+            break;
+        case ELECT_SEED_EVENT:
+            LOG_DEBUG("+ seed event.\n");
+            if (ELECT_HANDOFF) {
+                _seed(fsm, content);
+            }
+            break;
+        case ELECT_SENSOR_EVENT:
+            LOG_DEBUG("+ sensor event.\n");
+            _sensor(fsm, content);
+            break;
+        case ELECT_POLL_EVENT:
+            if ((fsm->state == ELECT_STATE_COORDINATOR) ||
+                (ELECT_GROUPS && (fsm->state == ELECT_STATE_CLIENT))) {
+                poll_tick();
+            }
+            break;
+        case ELECT_POLL_DONE_EVENT:
+            LOG_DEBUG("+ poll done event.\n");
+            poll_done();
+            break;
+        case ELECT_LEADER_THRESHOLD_EVENT:
+            LOG_DEBUG("+ leader threshold event.\n");
+            _threshold(fsm);
+            break;
+        default:
+            LOG_WARNING("??? invalid event (%x) ???\n", type);
+            break;
+    }
+    if (fsm->state != prev) {
+        stats_inc(ELECT_STATS_ROLE_CHANGE);
+        LOG_INFO("state: %s\n", state_names[fsm->state]);
+    }
+}
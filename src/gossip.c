@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       Adaptive node ID broadcasts following Trickle (RFC 6206)
+ *
+ * Each interval has a random broadcast point in its second half. The
+ * highest known node ID is broadcast there, unless it was heard
+ * ELECT_GOSSIP_K times in this interval already. As long as no higher ID
+ * shows up the interval doubles, so a consistent link falls silent quickly.
+ * RIOT's trickle module is not used as it is bound to xtimer and IPC, the
+ * state machine timers are used instead.
+ *
+ * @}
+ */
+
+#include <stdint.h>
+
+#include "log.h"
+#include "random.h"
+
+#include "elect.h"
+
+/**
+ * @brief Maximum interval in ms
+ */
+#define GOSSIP_IMAX     ((uint32_t)ELECT_GOSSIP_IMIN << ELECT_GOSSIP_DOUBLINGS)
+
+/* --- internal helper functions --- */
+
+static void _begin(elect_gossip_t *gossip)
+{
+    uint32_t half = gossip->interval / 2;
+    uint32_t point = half + random_uint32_range(0, gossip->interval - half);
+    gossip->heard = 0;
+    gossip->sent = false;
+    gossip->rest = gossip->interval - point;
+    fsm_timer_set(ELECT_TIMER_GOSSIP, point);
+}
+
+/* --- public interface functions --- */
+
+void gossip_start(elect_gossip_t *gossip, const ipv6_addr_t *best)
+{
+    gossip->best = *best;
+    gossip->interval = ELECT_GOSSIP_IMIN;
+    _begin(gossip);
+}
+
+void gossip_stop(elect_gossip_t *gossip)
+{
+    (void)gossip;
+    fsm_timer_stop(ELECT_TIMER_GOSSIP);
+}
+
+void gossip_heard(elect_gossip_t *gossip, const ipv6_addr_t *id)
+{
+    int cmp = ipv6_addr_cmp(&gossip->best, id);
+    if (cmp == 0) {
+        if (gossip->heard < UINT8_MAX) {
+            gossip->heard++;
+        }
+    }
+    else if (cmp < 0) {
+        /* inconsistent, spread new ID fast, unless already at minimum */
+        LOG_DEBUG("%s: higher ID, reset interval\n", __func__);
+        gossip->best = *id;
+        gossip->heard = 0;
+        if (gossip->interval > ELECT_GOSSIP_IMIN) {
+            gossip_start(gossip, id);
+        }
+    }
+}
+
+void gossip_timer(elect_gossip_t *gossip)
+{
+    if (!gossip->sent) {
+        if (gossip->heard < ELECT_GOSSIP_K) {
+            broadcast_id(&gossip->best);
+        }
+        gossip->sent = true;
+        fsm_timer_set(ELECT_TIMER_GOSSIP, gossip->rest);
+        return;
+    }
+    if (gossip->interval < GOSSIP_IMAX) {
+        gossip->interval *= 2;
+    }
+    _begin(gossip);
+}
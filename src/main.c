@@ -29,28 +29,23 @@
 #include "random.h"
 
 #include "msg.h"
-#include "evtimer_msg.h"
 #include "xtimer.h"
 
 #include "elect.h"
 
-static msg_t _main_msg_queue[ELECT_NODES_NUM];
+static msg_t _main_msg_queue[ELECT_MAIN_QUEUE_SIZE];
 
 /**
- * @name event time configuration
- * @{
+ * @brief Event types of the timers
  */
-static evtimer_msg_t evtimer;
-static evtimer_msg_event_t interval_event = {
-    .event  = { .offset = ELECT_MSG_INTERVAL },
-    .msg    = { .type = ELECT_INTERVAL_EVENT}};
-static evtimer_msg_event_t leader_timeout_event = {
-    .event  = { .offset = ELECT_LEADER_TIMEOUT },
-    .msg    = { .type = ELECT_LEADER_TIMEOUT_EVENT}};
-static evtimer_msg_event_t leader_threshold_event = {
-    .event  = { .offset = ELECT_LEADER_THRESHOLD },
-    .msg    = { .type = ELECT_LEADER_THRESHOLD_EVENT}};
-/** @} */
+static const uint16_t timer_types[ELECT_TIMER_NUMOF] = {
+    [ELECT_TIMER_INTERVAL]          = ELECT_INTERVAL_EVENT,
+    [ELECT_TIMER_LEADER_TIMEOUT]    = ELECT_LEADER_TIMEOUT_EVENT,
+    [ELECT_TIMER_LEADER_THRESHOLD]  = ELECT_LEADER_THRESHOLD_EVENT,
+    [ELECT_TIMER_GOSSIP]            = ELECT_GOSSIP_EVENT,
+    [ELECT_TIMER_REGISTER]          = ELECT_REGISTER_EVENT,
+    [ELECT_TIMER_BENCH]             = ELECT_BENCH_EVENT,
+};
 
 /**
  * @brief   Initialise network, coap, and sensor functions
@@ -60,12 +55,7 @@ static evtimer_msg_event_t leader_threshold_event = {
 int setup(void)
 {
     LOG_DEBUG("%s: begin\n", __func__);
-    /* avoid unused variable error */
-    (void) interval_event;
-    (void) leader_timeout_event;
-    (void) leader_threshold_event;
-
-    msg_init_queue(_main_msg_queue, ELECT_NODES_NUM);
+    msg_init_queue(_main_msg_queue, ELECT_MAIN_QUEUE_SIZE);
     kernel_pid_t main_pid = thread_getpid();
 
     if (net_init(main_pid) != 0) {
@@ -85,77 +75,45 @@ int setup(void)
         return 5;
     }
     LOG_DEBUG("%s: done\n", __func__);
-    evtimer_init_msg(&evtimer);
-    /* send initial `TICK` to start eventloop */
-    msg_send(&interval_event.msg, main_pid);
+    deadline_init(main_pid);
+    /* initial `TICK` to start eventloop */
+    deadline_set(ELECT_TIMER_INTERVAL, 0);
+    if (ELECT_BENCH) {
+        deadline_set(ELECT_TIMER_BENCH, ELECT_MSG_INTERVAL);
+    }
     return 0;
 }
 
-typedef enum {
-  DISCOVER, ELECT, CLIENT, COORDINATOR
-} State;
-
-#define u (16)
-
-
-void startIntervalTimer(void){
-    // reset event timer offset
-    interval_event.event.offset = ELECT_MSG_INTERVAL;
-    // (re)schedule event message
-    evtimer_add_msg(&evtimer, &interval_event, thread_getpid());
-}
-
-void stopIntervalTimer(void){
-    // delete event
-    evtimer_del(&evtimer, &interval_event.event);
-}
-
-void restartIntervalTimer(void){
-    stopIntervalTimer();
-    startIntervalTimer();
-}
-
-
-
-void startLeaderTimeout(void){
-    // reset event timer offset
-    leader_timeout_event.event.offset = ELECT_LEADER_TIMEOUT;
-    // (re)schedule event message
-    evtimer_add_msg(&evtimer, &leader_timeout_event, thread_getpid());
-}
-
-void stopLeaderTimeout(void){
-    // delete event
-    evtimer_del(&evtimer, &leader_timeout_event.event);
-}
-
-void restartLeaderTimeout(void){
-    stopLeaderTimeout();
-    startLeaderTimeout();
-}
-
-
-
-
-void startLeaderThreshold(void){
-    // reset event timer offset
-    leader_threshold_event.event.offset = ELECT_LEADER_THRESHOLD;
-    // (re)schedule event message
-    evtimer_add_msg(&evtimer, &leader_threshold_event, thread_getpid());
+void fsm_timer_set(unsigned timer, uint32_t offset)
+{
+    deadline_set(timer, offset);
 }
 
-void stopLeaderThreshold(void){
-    // delete event
-    evtimer_del(&evtimer, &leader_threshold_event.event);
+void fsm_timer_stop(unsigned timer)
+{
+    deadline_stop(timer);
 }
 
-void restartLeaderThreshold(void){
-    stopLeaderThreshold();
-    startLeaderThreshold();
+/**
+ * @brief Handle an event, and account the time it took
+ */
+static void _handle(elect_fsm_t *fsm, uint16_t type, void *content)
+{
+    ELECT_TRACE(ELECT_TRACE_EVENT, type, fsm->state);
+    uint32_t eventStart = xtimer_now_usec();
+    if (type == ELECT_BENCH_EVENT) {
+        stats_print(fsm_interval(fsm));
+        deadline_set(ELECT_TIMER_BENCH, ELECT_MSG_INTERVAL);
+    } else if (type == ELECT_LEISURE_EVENT) {
+        /* group requests come from the coordinator, only clients know it */
+        coap_put_sensor_group((fsm->state == ELECT_STATE_CLIENT)
+                              ? &fsm->coordinator : NULL);
+    } else {
+        fsm_handle(fsm, type, content);
+    }
+    stats_event(type, xtimer_now_usec() - eventStart, msg_avail());
 }
 
-
-
 int main(void)
 {
     /* this should be first */
@@ -163,166 +121,36 @@ int main(void)
         return 1;
     }
 
-    // Variables
-    State state = DISCOVER; // global state
+    elect_fsm_t fsm;
     ipv6_addr_t myIP; // stores our ip
-    ipv6_addr_t receivedIP; // stores the latest received ip
-    ipv6_addr_t coordinatorIP; // stores the ip of the coordinator
-
-    // Variables needed only for coordinator
-    ipv6_addr_t clients[ELECT_NODES_NUM];
-    int clientCnt = 0;
-    int16_t meanSensorValue = 0;
 
     // read own ip
     get_node_ip_addr(&myIP); // TODO: error handling?
+    fsm_init(&fsm, &myIP);
 
-    // assume we are coordinator
-    coordinatorIP = myIP;    
-    restartLeaderThreshold();
-    
     while(true) {
         msg_t m;
         msg_receive(&m);
-        switch (m.type) {
-        case ELECT_INTERVAL_EVENT:
-            LOG_DEBUG("+ interval event.\n");
-            if(state == DISCOVER) {
-                broadcast_id(&myIP);
-                restartIntervalTimer();
-            } else if(state == COORDINATOR) {
-              // reset sensor
-              meanSensorValue = sensor_read();
-              // Query all clients for their sensor value
-              char addr_str[IPV6_ADDR_MAX_STR_LEN];
-              LOG_DEBUG("\n\n\nStarting Query...\n");
-              for(int i = 0; i < clientCnt; i++){
-                coap_get_sensor(clients[i]);
-                ipv6_addr_to_str(addr_str, (clients + i), sizeof(addr_str));
-                LOG_DEBUG("Asking %s for sensor value.\n", addr_str);
-              }
-              LOG_DEBUG("Query done.\n\n\n");
-              restartIntervalTimer();
-            }
-            break;
-        case ELECT_BROADCAST_EVENT:
-            LOG_DEBUG("+ broadcast event, from [%s]", (char *)m.content.ptr);
-
-            // store IP
-            ipv6_addr_from_str(&receivedIP, m.content.ptr);
-            
-            if(state == DISCOVER){
-              if (ipv6_addr_cmp(&myIP, &receivedIP) < 0) {
-                // received bigger IP ==> stop broadcasting
-                state = ELECT;
-                coordinatorIP = receivedIP;
-                stopIntervalTimer();
-                restartLeaderThreshold();
-              }
-            } else if (state == ELECT){
-              int result = ipv6_addr_cmp(&coordinatorIP, &receivedIP);
-              if (result != 0) {
-                // IP changed, restart threshold
-                restartLeaderThreshold();
-                
-                if(result < 0){
-                    // change coordinatorIP
-                    coordinatorIP = receivedIP;
-                }
-              }
-            } else if(state == CLIENT || state == COORDINATOR){
-                // someone joined or something
-                if(ipv6_addr_cmp(&myIP, &receivedIP) < 0){
-                    coordinatorIP = receivedIP;
-                    state = ELECT;
-                    restartLeaderThreshold();
-                } else {
-                    coordinatorIP = myIP;
-                    state = DISCOVER;
-                
-                    restartIntervalTimer();
-                    restartLeaderThreshold();
-                }
-            }
-            break;
-        case ELECT_LEADER_ALIVE_EVENT:
-            LOG_DEBUG("+ leader event.\n");
-            restartLeaderTimeout();
-            break;
-        case ELECT_LEADER_TIMEOUT_EVENT:
-            LOG_DEBUG("+ leader timeout event.\n");
-            if(state == CLIENT){
-              // coordinator died
-              coordinatorIP = myIP;
-              state = DISCOVER;
-              restartIntervalTimer();
-              restartLeaderThreshold();
-            }
-            break;
-        case ELECT_NODES_EVENT:
-            LOG_DEBUG("+ nodes event, from [%s].\n", (char *)m.content.ptr);
-            if(state == COORDINATOR){
-              if(clientCnt < ELECT_NODES_NUM) {
-                // store IP
-                ipv6_addr_from_str(&receivedIP, m.content.ptr);
-                
-                bool found = false;
-                 for(int i = 0; i < clientCnt; i++){
-                    if(ipv6_addr_cmp(clients + i, &receivedIP) == 0){
-                        found = true;
-                        break;
-                    }
-                }
-                
-                if(!found) {
-                    LOG_DEBUG("\n\nADDED %s to client list as #%i\n\n", (char *)m.content.ptr, clientCnt);
-                    ipv6_addr_from_str(clients + clientCnt, m.content.ptr);
-                    clientCnt++;
-                }
-              } else {
-                //TODO: error handling too many clients
-              }
-            }
-            break;
-        case ELECT_SENSOR_EVENT:
-            LOG_DEBUG("+ sensor event, value=%s\n",  (char *)m.content.ptr);
-            if (state == COORDINATOR){
-              int16_t value = (int16_t)strtol((char *)m.content.ptr, NULL, 10);
-              meanSensorValue = (u-1) * meanSensorValue / u + value / u;
-              LOG_DEBUG("\n\nmean=%i, value=%i\n\n", meanSensorValue, value);
-              broadcast_sensor(meanSensorValue);
-            }
-            break;
-        case ELECT_LEADER_THRESHOLD_EVENT:
-            LOG_DEBUG("+ leader threshold event.\n");
-            if(state == DISCOVER || state == ELECT) {
-              if(ipv6_addr_cmp(&myIP, &coordinatorIP) == 0){
-                // we are coordinator
-                state = COORDINATOR;
-                LOG_DEBUG("\n\nWE ARE COORDINATOR\n\n");
-                clientCnt = 0;
-                meanSensorValue = sensor_read();
-                restartIntervalTimer();
-              } else {
-                // we are client
-                state = CLIENT;
-                char addr_str[IPV6_ADDR_MAX_STR_LEN];
-                ipv6_addr_to_str(addr_str, &coordinatorIP, sizeof(addr_str));
-                LOG_DEBUG("\n\nWE ARE CLIENT\nCoordinator is %s\n\n", addr_str);
-                coap_put_node(coordinatorIP, myIP);
-                restartLeaderTimeout();
-              }
+        if (m.type != ELECT_DEADLINE_EVENT) {
+            _handle(&fsm, m.type, m.content.ptr);
+            /* content passed by the listener is owned by main, give it back */
+            bool pooled = ((m.type == ELECT_BROADCAST_EVENT) ||
+                           (m.type == ELECT_RELAY_EVENT) ||
+                           (m.type == ELECT_SENSOR_EVENT) ||
+                           (m.type == ELECT_STANDBY_EVENT) ||
+                           (m.type == ELECT_AGGREGATE_EVENT)) &&
+                          (listen_release(m.content.ptr) == 0);
+            /* !!! DO NOT REMOVE !!! */
+            if (!pooled && (m.type != ELECT_POLL_EVENT) &&
+                (m.type != ELECT_LEISURE_EVENT)) {
+                msg_reply(&m, &m);
             }
-            break;
-        default:
-            LOG_WARNING("??? invalid event (%x) ???\n", m.type);
-            break;
         }
-        /* !!! DO NOT REMOVE !!! */
-        if ((m.type != ELECT_INTERVAL_EVENT) &&
-            (m.type != ELECT_LEADER_TIMEOUT_EVENT) &&
-            (m.type != ELECT_LEADER_THRESHOLD_EVENT)) {
-            msg_reply(&m, &m);
+        /* one wakeup for all timers that are due, checked after any message
+         * as the wakeup is lost if the queue was full */
+        int timer;
+        while ((timer = deadline_next()) >= 0) {
+            _handle(&fsm, timer_types[timer], NULL);
         }
     }
     /* should never be reached */
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       Membership table of the coordinator
+ *
+ * Members are kept densely packed in a static pool, which allows cheap
+ * iteration. A hash index with linear probing, keyed on the interface ID
+ * of the link local address, provides O(1) lookup, insert, and removal.
+ *
+ * @}
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "log.h"
+#include "net/ipv6/addr.h"
+
+#include "elect.h"
+
+/**
+ * @brief Number of slots in hash index, keeps load factor at most 0.5
+ */
+#define MEMBERS_SLOTS       (2U * ELECT_MEMBERS_NUM)
+
+/**
+ * @brief Marker for unused slot in hash index
+ */
+#define MEMBERS_SLOT_FREE   (0U)
+
+/* densely packed member entries */
+static elect_member_t _pool[ELECT_MEMBERS_NUM];
+/* hash index, holds position in pool + 1 */
+static uint16_t _slots[MEMBERS_SLOTS];
+static unsigned _count;
+
+/* --- internal helper functions --- */
+
+static inline uint64_t _iid(const ipv6_addr_t *addr)
+{
+    uint64_t iid;
+    memcpy(&iid, &addr->u8[ELECT_FRAME_IID_LEN], sizeof(iid));
+    return iid;
+}
+
+static inline unsigned _hash(uint64_t iid)
+{
+    /* Fibonacci hashing, spreads sequential IDs across the index */
+    return (unsigned)((iid * 0x9e3779b97f4a7c15ULL) >> 32) % MEMBERS_SLOTS;
+}
+
+/**
+ * @brief Find slot of given interface ID, or free slot to insert it into
+ */
+static unsigned _lookup(uint64_t iid)
+{
+    unsigned slot = _hash(iid);
+    while ((_slots[slot] != MEMBERS_SLOT_FREE) &&
+           (_pool[_slots[slot] - 1].iid != iid)) {
+        slot = (slot + 1) % MEMBERS_SLOTS;
+    }
+    return slot;
+}
+
+/**
+ * @brief Remove entry from hash index, shifting back successors of the
+ *        probe sequence so no tombstones are needed
+ */
+static void _unlink(unsigned slot)
+{
+    unsigned next = slot;
+    _slots[slot] = MEMBERS_SLOT_FREE;
+    while (1) {
+        next = (next + 1) % MEMBERS_SLOTS;
+        if (_slots[next] == MEMBERS_SLOT_FREE) {
+            return;
+        }
+        unsigned home = _hash(_pool[_slots[next] - 1].iid);
+        /* move entry if its home slot is not within (slot, next] */
+        bool stays = (slot <= next) ? ((slot < home) && (home <= next))
+                                    : ((slot < home) || (home <= next));
+        if (!stays) {
+            _slots[slot] = _slots[next];
+            _slots[next] = MEMBERS_SLOT_FREE;
+            slot = next;
+        }
+    }
+}
+
+/* --- public interface functions --- */
+
+void members_clear(void)
+{
+    memset(_slots, 0, sizeof(_slots));
+    _count = 0;
+}
+
+unsigned members_count(void)
+{
+    return _count;
+}
+
+elect_member_t *members_get(unsigned idx)
+{
+    return (idx < _count) ? &_pool[idx] : NULL;
+}
+
+elect_member_t *members_find(const ipv6_addr_t *addr)
+{
+    unsigned slot = _lookup(_iid(addr));
+    if (_slots[slot] == MEMBERS_SLOT_FREE) {
+        return NULL;
+    }
+    return &_pool[_slots[slot] - 1];
+}
+
+elect_member_t *members_add(const ipv6_addr_t *addr, bool *is_new)
+{
+    if (!ipv6_addr_is_link_local(addr)) {
+        LOG_WARNING("%s: not a link local address!\n", __func__);
+        return NULL;
+    }
+    uint64_t iid = _iid(addr);
+    unsigned slot = _lookup(iid);
+    *is_new = (_slots[slot] == MEMBERS_SLOT_FREE);
+    if (!*is_new) {
+        return &_pool[_slots[slot] - 1];
+    }
+    if (_count >= ELECT_MEMBERS_NUM) {
+        LOG_WARNING("%s: table full (%u)!\n", __func__, _count);
+        return NULL;
+    }
+    elect_member_t *member = &_pool[_count++];
+    memset(member, 0, sizeof(*member));
+    member->iid = iid;
+    _slots[slot] = (uint16_t)_count;
+    return member;
+}
+
+int members_remove(const ipv6_addr_t *addr)
+{
+    unsigned slot = _lookup(_iid(addr));
+    if (_slots[slot] == MEMBERS_SLOT_FREE) {
+        return 1;
+    }
+    unsigned pos = _slots[slot] - 1;
+    _unlink(slot);
+    /* keep pool dense by moving last entry into the gap */
+    if (pos != --_count) {
+        _pool[pos] = _pool[_count];
+        _slots[_lookup(_pool[pos].iid)] = (uint16_t)(pos + 1);
+    }
+    return 0;
+}
+
+void members_addr(const elect_member_t *member, ipv6_addr_t *addr)
+{
+    memset(addr, 0, sizeof(ipv6_addr_t));
+    ipv6_addr_set_link_local_prefix(addr);
+    memcpy(&addr->u8[ELECT_FRAME_IID_LEN], &member->iid, sizeof(member->iid));
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       Paced polling of sensor values by the coordinator
+ *
+ * The requests of a poll round are spread evenly, with jitter, across
+ * ELECT_POLL_SPREAD percent of the election interval. At most
+ * ELECT_POLL_WINDOW requests are in flight, requests that are due while
+ * the window is full are sent as soon as a response or timeout frees a
+ * slot.
+ *
+ * @}
+ */
+
+#include <stdint.h>
+
+#include "log.h"
+#include "msg.h"
+#include "random.h"
+#include "thread.h"
+#include "xtimer.h"
+
+#include "elect.h"
+
+static xtimer_t poll_timer;
+static msg_t poll_msg = { .type = ELECT_POLL_EVENT };
+/* position of next member to poll in this round */
+static unsigned poll_next;
+/* number of requests in flight */
+static unsigned poll_inflight;
+/* number of requests that are due, but not sent yet as the window is full */
+static unsigned poll_due;
+/* gap between two requests in us */
+static uint32_t poll_gap;
+
+/* --- internal helper functions --- */
+
+static void _schedule(void)
+{
+    /* jitter of +-25% avoids collisions with other periodic traffic */
+    uint32_t offset = poll_gap - (poll_gap / 4) +
+                      random_uint32_range(0, (poll_gap / 2) + 1);
+    xtimer_set_msg(&poll_timer, offset, &poll_msg, thread_getpid());
+}
+
+/**
+ * @brief Send due requests, as far as the window allows
+ */
+static void _send_due(void)
+{
+    while ((poll_due > 0) && (poll_inflight < ELECT_POLL_WINDOW) &&
+           (poll_next < members_count())) {
+        ipv6_addr_t client;
+        members_addr(members_get(poll_next++), &client);
+        poll_due--;
+        if (coap_get_sensor(client) == 0) {
+            poll_inflight++;
+        }
+    }
+    if (poll_next >= members_count()) {
+        poll_due = 0;
+    }
+}
+
+/**
+ * @brief Schedule next request, if any is left in this round
+ */
+static void _schedule_next(void)
+{
+    if ((poll_next + poll_due) < members_count()) {
+        _schedule();
+    }
+}
+
+/* --- public interface functions --- */
+
+void poll_start(uint32_t interval)
+{
+    unsigned count = members_count();
+    LOG_DEBUG("%s: polling %u client(s)\n", __func__, count);
+    xtimer_remove(&poll_timer);
+    poll_next = 0;
+    poll_due = 0;
+    if (count == 0) {
+        return;
+    }
+    poll_gap = (interval * US_PER_MS / 100U) *
+               ELECT_POLL_SPREAD / count;
+    poll_due = 1;
+    _send_due();
+    _schedule_next();
+}
+
+void poll_tick(void)
+{
+    poll_due++;
+    _send_due();
+    _schedule_next();
+}
+
+void poll_done(void)
+{
+    if (poll_inflight > 0) {
+        poll_inflight--;
+    }
+    _send_due();
+}
+
+void poll_stop(void)
+{
+    xtimer_remove(&poll_timer);
+    poll_next = 0;
+    poll_due = 0;
+}
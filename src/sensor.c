@@ -13,12 +13,21 @@
  * @file
  * @brief       Sensor wrapper code
  *
+ * The sensor is read by a background thread every ELECT_SENSOR_PERIOD, as
+ * reading the HDC1000 waits for its conversion. Samples are double
+ * buffered: the thread writes the slot not in use and switches over
+ * afterwards, so sensor_read() returns a consistent sample without waiting.
+ *
  * @author      Sebastian Meiling <s@mlng.net>
  *
  * @}
  */
 
+#include <stdint.h>
+
 #include "log.h"
+#include "thread.h"
+#include "xtimer.h"
 #ifdef MODULE_HDC1000
 #include "hdc1000.h"
 #include "hdc1000_params.h"
@@ -50,7 +59,77 @@ static hdc1000_t dev_hdc1000;
  */
 #define ELECT_SENSOR_ALPHA      (4U)
 
+/**
+ * @brief Number of fractional bits of filtered values
+ */
+#define SENSOR_FILTER_FRAC      (8U)
+
+/**
+ * @brief Values of one sample
+ */
+typedef struct {
+    int16_t temp;   /**< temperature as degree Celsius x100 */
+    int16_t hum;    /**< relative humidity as percent x100 */
+} sensor_sample_t;
+
+/* last raw values of the device */
 static int16_t temp, hum;
+/* filtered values, if ELECT_SENSOR_FILTER */
+static int32_t filt_temp, filt_hum;
+/* double buffer, sensor_latest is the slot readers use */
+static sensor_sample_t sensor_slots[2];
+static volatile unsigned sensor_latest;
+static char sensor_stack[ELECT_SENSOR_STACKSIZE];
+
+/* --- internal helper functions --- */
+
+static int16_t _filter(int32_t *filt, int16_t raw)
+{
+    *filt += ((raw * (1 << SENSOR_FILTER_FRAC)) - *filt) >> ELECT_SENSOR_FILTER;
+    return (int16_t)((*filt + (1 << (SENSOR_FILTER_FRAC - 1))) >>
+                     SENSOR_FILTER_FRAC);
+}
+
+/**
+ * @brief Read the device and publish the sample
+ */
+static void _sample(void)
+{
+#ifdef MODULE_HDC1000
+    hdc1000_read(&dev_hdc1000, &temp, &hum);
+#else
+    temp = (((ELECT_SENSOR_ALPHA - 1) * temp) +
+            (int16_t)random_uint32_range(ELECT_SENSOR_TEMP_MIN, ELECT_SENSOR_TEMP_MAX)) / ELECT_SENSOR_ALPHA;
+    hum  = (((ELECT_SENSOR_ALPHA - 1) * hum)  +
+            (int16_t)random_uint32_range(ELECT_SENSOR_HUM_MIN, ELECT_SENSOR_HUM_MAX)) / ELECT_SENSOR_ALPHA;
+#endif /* MODULE_HDC1000 */
+    LOG_DEBUG("%s: raw T: %"PRIi16", H: %"PRIi16"\n", __func__, temp, hum);
+    sensor_sample_t *slot = &sensor_slots[!sensor_latest];
+    if (ELECT_SENSOR_FILTER) {
+        slot->temp = _filter(&filt_temp, temp);
+        slot->hum  = _filter(&filt_hum, hum);
+    }
+    else {
+        slot->temp = temp;
+        slot->hum  = hum;
+    }
+    sensor_latest = !sensor_latest;
+    ELECT_TRACE(ELECT_TRACE_SENSOR_READ, slot->temp, slot->hum);
+}
+
+static void *_sample_loop(void *arg)
+{
+    (void)arg;
+    xtimer_ticks32_t last = xtimer_now();
+    while (1) {
+        xtimer_periodic_wakeup(&last, ELECT_SENSOR_PERIOD * US_PER_MS);
+        _sample();
+    }
+    /* should never be reached */
+    return NULL;
+}
+
+/* --- public interface functions --- */
 
 int sensor_init(void)
 {
@@ -66,23 +145,21 @@ int sensor_init(void)
     temp = (int16_t)random_uint32_range(ELECT_SENSOR_TEMP_MIN, ELECT_SENSOR_TEMP_MAX);
     hum  = (int16_t)random_uint32_range(ELECT_SENSOR_HUM_MIN, ELECT_SENSOR_HUM_MAX);
 #endif /* MODULE_HDC1000 */
-    LOG_DEBUG("%s: raw T: %"PRIi16", H: %"PRIi16"\n", __func__, temp, hum);
+    filt_temp = temp * (1 << SENSOR_FILTER_FRAC);
+    filt_hum  = hum * (1 << SENSOR_FILTER_FRAC);
+    /* first sample is taken here, so a value is available right away */
+    _sample();
+    if (thread_create(sensor_stack, sizeof(sensor_stack),
+                      (THREAD_PRIORITY_MAIN + 1), THREAD_CREATE_STACKTEST,
+                      _sample_loop, NULL, "sensor") <= KERNEL_PID_UNDEF) {
+        LOG_ERROR("%s: can not start sensor thread!\n", __func__);
+        return 2;
+    }
     LOG_DEBUG("%s: done\n", __func__);
     return 0;
 }
 
 int16_t sensor_read(void)
 {
-    LOG_DEBUG("%s: begin\n", __func__);
-#ifdef MODULE_HDC1000
-    hdc1000_read(&dev_hdc1000, &temp, &hum);
-#else
-    temp = (((ELECT_SENSOR_ALPHA - 1) * temp) +
-            (int16_t)random_uint32_range(ELECT_SENSOR_TEMP_MIN, ELECT_SENSOR_TEMP_MAX)) / ELECT_SENSOR_ALPHA;
-    hum  = (((ELECT_SENSOR_ALPHA - 1) * hum)  +
-            (int16_t)random_uint32_range(ELECT_SENSOR_HUM_MIN, ELECT_SENSOR_HUM_MAX)) / ELECT_SENSOR_ALPHA;
-#endif /* MODULE_HDC1000 */
-    LOG_DEBUG("%s: raw T: %"PRIi16", H: %"PRIi16"\n", __func__, temp, hum);
-    LOG_DEBUG("%s: done\n", __func__);
-    return temp;
+    return sensor_slots[sensor_latest].temp;
 }
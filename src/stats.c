@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       Runtime statistics of the event loop and network traffic
+ *
+ * Latencies are recorded as count, sum, maximum, and a histogram with
+ * ELECT_STATS_BUCKETS buckets, each 4 times wider than the previous one,
+ * starting at ELECT_STATS_BUCKET_MIN us.
+ *
+ * @}
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sched.h"
+#include "thread.h"
+#include "xtimer.h"
+
+#include "elect.h"
+
+/**
+ * @brief Latency statistics
+ */
+typedef struct {
+    uint32_t count;                         /**< number of samples */
+    uint32_t sum;                           /**< sum of latencies in us */
+    uint32_t max;                           /**< max. latency in us */
+    uint16_t hist[ELECT_STATS_BUCKETS];     /**< latency histogram */
+} stats_lat_t;
+
+/**
+ * @brief Event types, index matches the statistics in stats_events
+ */
+static const uint16_t stats_types[] = {
+    ELECT_BROADCAST_EVENT,
+    ELECT_INTERVAL_EVENT,
+    ELECT_LEADER_ALIVE_EVENT,
+    ELECT_LEADER_THRESHOLD_EVENT,
+    ELECT_LEADER_TIMEOUT_EVENT,
+    ELECT_NODES_EVENT,
+    ELECT_SENSOR_EVENT,
+    ELECT_POLL_EVENT,
+    ELECT_POLL_DONE_EVENT,
+    ELECT_GOSSIP_EVENT,
+    ELECT_RELAY_EVENT,
+    ELECT_PARENT_EVENT,
+    ELECT_STANDBY_EVENT,
+    ELECT_SYNC_EVENT,
+    ELECT_AGGREGATE_EVENT,
+    ELECT_LIST_EVENT,
+    ELECT_SEED_EVENT,
+    ELECT_REGISTER_EVENT,
+    ELECT_REGISTERED_EVENT,
+};
+
+/**
+ * @brief Names of counters, as printed by stats_print()
+ */
+static const char *stats_names[ELECT_STATS_NUMOF] = {
+    "bcast_tx", "bcast_rx", "poll_tx", "coap_timeout", "coap_error",
+    "role_change", "rx_drop", "round_incomplete", "sensor_tx", "bcast_dup",
+    "reg_retry", "aggr_tx", "standby_tx", "sync_tx", "nodes_tx", "reg_tx",
+    "announce_tx",
+};
+
+#define STATS_EVENTS_NUMOF  (sizeof(stats_types) / sizeof(stats_types[0]))
+
+static stats_lat_t stats_events[STATS_EVENTS_NUMOF];
+static stats_lat_t stats_rounds;
+static uint32_t stats_counters[ELECT_STATS_NUMOF];
+static unsigned stats_queue_max;
+/* start of current poll round in us, and members yet to respond */
+static uint32_t stats_round_begin;
+static unsigned stats_round_pending;
+
+/* --- internal helper functions --- */
+
+static void _record(stats_lat_t *lat, uint32_t usec)
+{
+    unsigned bucket = 0;
+    uint32_t limit = ELECT_STATS_BUCKET_MIN;
+    while ((usec >= limit) && (bucket < (ELECT_STATS_BUCKETS - 1))) {
+        limit <<= 2;
+        bucket++;
+    }
+    lat->count++;
+    lat->sum += usec;
+    if (usec > lat->max) {
+        lat->max = usec;
+    }
+    if (lat->hist[bucket] < UINT16_MAX) {
+        lat->hist[bucket]++;
+    }
+}
+
+/**
+ * @brief Writer for CBOR output, keeps the part of it in a window
+ */
+typedef struct {
+    uint8_t *buf;       /**< target of the window */
+    size_t len;         /**< size of the window */
+    size_t offset;      /**< offset of the window in the output */
+    size_t pos;         /**< length of the output so far */
+} stats_writer_t;
+
+static void _put(stats_writer_t *w, const uint8_t *bytes, size_t n)
+{
+    for (size_t i = 0; i < n; ++i, ++w->pos) {
+        if ((w->pos >= w->offset) && ((w->pos - w->offset) < w->len)) {
+            w->buf[w->pos - w->offset] = bytes[i];
+        }
+    }
+}
+
+/* unsigned integer of a fixed width of 2 or 4 bytes, regardless of its value */
+static void _put_uint(stats_writer_t *w, uint32_t val, unsigned width)
+{
+    uint8_t head[5] = { (width == 2) ? 0x19 : 0x1a };
+    for (unsigned i = 0; i < width; ++i) {
+        head[1 + i] = (uint8_t)(val >> (8 * (width - 1 - i)));
+    }
+    _put(w, head, 1 + width);
+}
+
+static void _put_array(stats_writer_t *w, unsigned items)
+{
+    uint8_t head[3];
+    _put(w, head, codec_put_array(head, sizeof(head), items));
+}
+
+static void _put_lat(stats_writer_t *w, const stats_lat_t *lat)
+{
+    _put_array(w, 3 + ELECT_STATS_BUCKETS);
+    _put_uint(w, lat->count, 4);
+    _put_uint(w, lat->sum, 4);
+    _put_uint(w, lat->max, 4);
+    for (unsigned i = 0; i < ELECT_STATS_BUCKETS; ++i) {
+        _put_uint(w, lat->hist[i], 2);
+    }
+}
+
+/* --- public interface functions --- */
+
+void stats_inc(unsigned counter)
+{
+    if (counter < ELECT_STATS_NUMOF) {
+        stats_counters[counter]++;
+    }
+}
+
+void stats_event(uint16_t type, uint32_t usec, unsigned queued)
+{
+    if (queued > stats_queue_max) {
+        stats_queue_max = queued;
+    }
+    for (unsigned i = 0; i < STATS_EVENTS_NUMOF; ++i) {
+        if (stats_types[i] == type) {
+            _record(&stats_events[i], usec);
+            return;
+        }
+    }
+}
+
+void stats_round_start(unsigned members)
+{
+    if (stats_round_pending > 0) {
+        stats_inc(ELECT_STATS_ROUND_INCOMPLETE);
+    }
+    stats_round_begin = xtimer_now_usec();
+    stats_round_pending = members;
+}
+
+void stats_round_resp(void)
+{
+    if ((stats_round_pending > 0) && (--stats_round_pending == 0)) {
+        _record(&stats_rounds, xtimer_now_usec() - stats_round_begin);
+    }
+}
+
+void stats_print(uint32_t interval)
+{
+    printf("stats: time=%" PRIu32 " interval=%" PRIu32,
+           xtimer_now_usec() / US_PER_MS, interval);
+    for (unsigned i = 0; i < ELECT_STATS_NUMOF; ++i) {
+        printf(" %s=%" PRIu32, stats_names[i], stats_counters[i]);
+    }
+    printf(" rounds=%" PRIu32 " round_sum=%" PRIu32 " round_max=%" PRIu32,
+           stats_rounds.count, stats_rounds.sum, stats_rounds.max);
+    printf(" queue_max=%u\n", stats_queue_max);
+#ifdef DEVELHELP
+    /* high-water marks of all threads, stacks are only known with DEVELHELP */
+    printf("stack:");
+    for (kernel_pid_t pid = KERNEL_PID_FIRST; pid <= KERNEL_PID_LAST; ++pid) {
+        thread_t *thread = (thread_t *)sched_threads[pid];
+        if (thread == NULL) {
+            continue;
+        }
+        int free = (int)thread_measure_stack_free(thread->stack_start);
+        printf(" %s=%d/%d", thread->name, thread->stack_size - free,
+               thread->stack_size);
+    }
+    printf("\n");
+#endif
+}
+
+size_t stats_dump(uint8_t *buf, size_t len, size_t offset)
+{
+    stats_writer_t w = { .buf = buf, .len = len, .offset = offset, .pos = 0 };
+
+    /* [[counters], queue max, round latency, [[type, latency], ...]] */
+    _put_array(&w, 4);
+    _put_array(&w, ELECT_STATS_NUMOF);
+    for (unsigned i = 0; i < ELECT_STATS_NUMOF; ++i) {
+        _put_uint(&w, stats_counters[i], 4);
+    }
+    _put_uint(&w, stats_queue_max, 4);
+    _put_lat(&w, &stats_rounds);
+    _put_array(&w, STATS_EVENTS_NUMOF);
+    for (unsigned i = 0; i < STATS_EVENTS_NUMOF; ++i) {
+        _put_array(&w, 2);
+        _put_uint(&w, stats_types[i], 2);
+        _put_lat(&w, &stats_events[i]);
+    }
+    return w.pos;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       Adaptive intervals and timeouts of the leader election
+ *
+ * The compile time parameters of elect.h serve as reference: the leader
+ * timeout is the same multiple of the observed gaps between signs of life
+ * of the leader, as it is of the nominal gap for the fixed parameters. The
+ * threshold is ELECT_TIMING_THRESHOLD_MULT times the time it took to learn
+ * the highest node ID in past elections. The interval of the coordinator
+ * leaves ELECT_TIMING_HEADROOM times the time a polling round needs,
+ * estimated from the round trip time like the retransmission timeout of
+ * TCP (RFC 6298) and the number of members.
+ *
+ * A gap longer than the current timeout spans a phase of another role, as
+ * the timer would have fired otherwise, and is ignored, as is the gap to the
+ * first sign of life of a new leader.
+ *
+ * @}
+ */
+
+#include <stdint.h>
+
+#include "log.h"
+#include "xtimer.h"
+
+#include "elect.h"
+
+/**
+ * @brief Nominal gap between signs of life of the leader in ms, it sends
+ *        the aggregate every interval
+ */
+#define TIMING_ALIVE_GAP    (ELECT_MSG_INTERVAL)
+
+/**
+ * @brief Nominal time to learn the highest node ID in ms, from the first
+ *        broadcast interval
+ */
+#define TIMING_LEARN        (ELECT_GOSSIP ? ELECT_GOSSIP_IMIN : ELECT_MSG_INTERVAL)
+
+/* --- internal helper functions --- */
+
+static uint32_t _clamp(uint64_t val, uint32_t min, uint32_t max)
+{
+    if (val < min) {
+        return min;
+    }
+    return (val > max) ? max : (uint32_t)val;
+}
+
+/**
+ * @brief Account a gap in the decaying maximum @p max
+ */
+static void _gap(uint32_t *max, uint32_t gap)
+{
+    *max -= *max >> ELECT_TIMING_DECAY_SHIFT;
+    if (gap > *max) {
+        *max = gap;
+    }
+}
+
+/* --- public interface functions --- */
+
+void timing_init(elect_timing_t *timing)
+{
+    timing->interval = ELECT_MSG_INTERVAL;
+    timing->srtt = 0;
+    timing->rttvar = 0;
+    timing->learn = TIMING_LEARN;
+    timing->elect_start = 0;
+    timing->alive_gap = TIMING_ALIVE_GAP;
+    timing->alive_last = 0;
+    timing->leader_interval = 0;
+}
+
+void timing_rtt(elect_timing_t *timing, uint32_t usec)
+{
+    if (usec == 0) {
+        return;
+    }
+    if (timing->srtt == 0) {
+        timing->srtt = usec;
+        timing->rttvar = usec / 2;
+        return;
+    }
+    uint32_t delta = (timing->srtt > usec) ? (timing->srtt - usec)
+                                           : (usec - timing->srtt);
+    // gains of 1/4 and 1/8 as recommended by RFC 6298
+    timing->rttvar = timing->rttvar - (timing->rttvar >> 2) + (delta >> 2);
+    timing->srtt = timing->srtt - (timing->srtt >> 3) + (usec >> 3);
+}
+
+void timing_elect(elect_timing_t *timing)
+{
+    timing->elect_start = xtimer_now_usec() / US_PER_MS;
+}
+
+void timing_heard(elect_timing_t *timing)
+{
+    uint32_t now = xtimer_now_usec() / US_PER_MS;
+    _gap(&timing->learn, now - timing->elect_start);
+}
+
+void timing_leader(elect_timing_t *timing)
+{
+    timing->alive_last = 0;
+    timing->leader_interval = 0;
+}
+
+void timing_alive(elect_timing_t *timing)
+{
+    uint32_t now = xtimer_now_usec() / US_PER_MS;
+    uint32_t gap = now - timing->alive_last;
+    if ((timing->alive_last != 0) && (gap < timing_timeout(timing))) {
+        _gap(&timing->alive_gap, gap);
+    }
+    timing->alive_last = now;
+}
+
+void timing_leader_interval(elect_timing_t *timing, uint32_t ms)
+{
+    if (ms > 0) {
+        timing->leader_interval = ms;
+    }
+}
+
+uint32_t timing_round(elect_timing_t *timing, unsigned members)
+{
+    if (!ELECT_TIMING) {
+        return timing->interval;
+    }
+    uint64_t rto = timing->srtt ? (timing->srtt + 4 * (uint64_t)timing->rttvar)
+                                : ELECT_TIMING_RTT_INIT;
+    uint64_t need;
+    if (ELECT_POLL_MODE == ELECT_POLL_UNICAST) {
+        // a window of requests per round trip, spread over part of the round
+        uint64_t windows = (members + ELECT_POLL_WINDOW - 1) /
+                           ELECT_POLL_WINDOW;
+        need = rto * windows * 100U / ELECT_POLL_SPREAD;
+    }
+    else if (ELECT_POLL_MODE == ELECT_POLL_GROUP) {
+        need = rto + (uint64_t)members * ELECT_TIMING_SLOT;
+    }
+    else {
+        // members push their values, there are no requests
+        need = (uint64_t)members * ELECT_TIMING_SLOT;
+    }
+    timing->interval = _clamp(need * ELECT_TIMING_HEADROOM / US_PER_MS,
+                              ELECT_TIMING_INTERVAL_MIN,
+                              ELECT_TIMING_INTERVAL_MAX);
+    LOG_DEBUG("%s: %u member(s), rto=%luus, interval=%lums\n", __func__,
+              members, (unsigned long)rto, (unsigned long)timing->interval);
+    return timing->interval;
+}
+
+uint32_t timing_scale(const elect_timing_t *timing, uint32_t ms)
+{
+    return (uint32_t)((uint64_t)ms * timing->interval / ELECT_MSG_INTERVAL);
+}
+
+uint32_t timing_leader_scale(const elect_timing_t *timing, uint32_t ms)
+{
+    uint32_t interval = (timing->leader_interval > timing->interval)
+                        ? timing->leader_interval : timing->interval;
+    return (uint32_t)((uint64_t)ms * interval / ELECT_MSG_INTERVAL);
+}
+
+uint32_t timing_threshold(const elect_timing_t *timing)
+{
+    if (!ELECT_TIMING) {
+        return ELECT_LEADER_THRESHOLD;
+    }
+    return _clamp((uint64_t)ELECT_TIMING_THRESHOLD_MULT * timing->learn,
+                  ELECT_TIMING_THRESHOLD_MIN, ELECT_TIMING_THRESHOLD_MAX);
+}
+
+uint32_t timing_timeout(const elect_timing_t *timing)
+{
+    if (!ELECT_TIMING) {
+        return ELECT_LEADER_TIMEOUT;
+    }
+    uint32_t timeout = _clamp((uint64_t)ELECT_LEADER_TIMEOUT *
+                              timing->alive_gap / TIMING_ALIVE_GAP,
+                              ELECT_TIMING_TIMEOUT_MIN,
+                              ELECT_TIMING_TIMEOUT_MAX);
+    // as many intervals of the leader as the fixed parameters allow for
+    uint32_t interval = timing->leader_interval ? timing->leader_interval
+                                                : ELECT_MSG_INTERVAL;
+    uint32_t rounds = (uint32_t)((uint64_t)ELECT_LEADER_TIMEOUT * interval /
+                                 ELECT_MSG_INTERVAL);
+    return (timeout > rounds) ? timeout : rounds;
+}
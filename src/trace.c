@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2017 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     vslab-riot
+ * @{
+ *
+ * @file
+ * @brief       Binary trace buffer for hot paths
+ *
+ * Trace records of fixed size are written to a RAM ring buffer, the oldest
+ * records are overwritten. The buffer is dumped on demand, e.g. via the
+ * CoAP resource `/trace`. Enabled by setting ELECT_TRACE_NUM, otherwise
+ * ELECT_TRACE() compiles to nothing.
+ *
+ * @}
+ */
+
+#include <stdint.h>
+
+#include "irq.h"
+#include "xtimer.h"
+
+#include "elect.h"
+
+#if ELECT_TRACE_NUM
+
+/**
+ * @brief Size of a dumped trace record in bytes
+ */
+#define TRACE_REC_SIZE  (12U)
+
+/**
+ * @brief Trace record
+ */
+typedef struct {
+    uint32_t time;      /**< timestamp in us */
+    uint16_t event;     /**< event ID, see ELECT_TRACE_* */
+    uint16_t arg0;      /**< first event argument */
+    uint32_t arg1;      /**< second event argument */
+} trace_rec_t;
+
+static trace_rec_t trace_buf[ELECT_TRACE_NUM];
+/* total number of records written, ring position is derived from it */
+static uint32_t trace_cnt;
+
+static uint8_t *_put_u16(uint8_t *buf, uint16_t val)
+{
+    buf[0] = (uint8_t)(val >> 8);
+    buf[1] = (uint8_t)val;
+    return buf + 2;
+}
+
+static uint8_t *_put_u32(uint8_t *buf, uint32_t val)
+{
+    buf = _put_u16(buf, (uint16_t)(val >> 16));
+    return _put_u16(buf, (uint16_t)val);
+}
+
+void trace_add(uint16_t event, uint16_t arg0, uint32_t arg1)
+{
+    uint32_t now = xtimer_now_usec();
+    unsigned state = irq_disable();
+    trace_rec_t *rec = &trace_buf[trace_cnt++ % ELECT_TRACE_NUM];
+    rec->time  = now;
+    rec->event = event;
+    rec->arg0  = arg0;
+    rec->arg1  = arg1;
+    irq_restore(state);
+}
+
+size_t trace_dump(uint8_t *buf, size_t len)
+{
+    unsigned state = irq_disable();
+    uint32_t num = (trace_cnt < ELECT_TRACE_NUM) ? trace_cnt : ELECT_TRACE_NUM;
+    if (num > (len / TRACE_REC_SIZE)) {
+        num = len / TRACE_REC_SIZE;
+    }
+    /* newest records that fit, in chronological order */
+    uint8_t *pos = buf;
+    for (uint32_t i = trace_cnt - num; i != trace_cnt; ++i) {
+        const trace_rec_t *rec = &trace_buf[i % ELECT_TRACE_NUM];
+        pos = _put_u32(pos, rec->time);
+        pos = _put_u16(pos, rec->event);
+        pos = _put_u16(pos, rec->arg0);
+        pos = _put_u32(pos, rec->arg1);
+    }
+    irq_restore(state);
+    return (size_t)(pos - buf);
+}
+
+#endif /* ELECT_TRACE_NUM */
@@ -20,8 +20,8 @@
 #include <stdbool.h>
 #include <string.h>
 
+#include "irq.h"
 #include "log.h"
-#include "fmt.h"
 #include "msg.h"
 #include "net/ipv6/addr.h"
 #include "net/gnrc.h"
@@ -35,14 +35,44 @@
 #include "elect.h"
 
 #define LISTEN_MSG_QUEUE_SIZE   (8U)
-#define LISTEN_STACKSIZE        (THREAD_STACKSIZE_MAIN)
+#define LISTEN_BUF_SIZE         (64U)
+#ifndef LISTEN_BUF_NUM
+#define LISTEN_BUF_NUM          (4U)
+#endif
+#define LISTEN_BUF_FREE_EVENT   (0x0900)
+#define AGGR_FRAME_LEN          (7 + ELECT_FRAME_IID_LEN)
 
-static char server_stack[LISTEN_STACKSIZE];
+/**
+ * @brief Receive buffer, owned by main while the decoded content is
+ *        processed, until returned with listen_release()
+ */
+typedef struct {
+    uint8_t data[LISTEN_BUF_SIZE];  /**< received datagram */
+    union {
+        ipv6_addr_t id;             /**< decoded node ID */
+        elect_sample_t sample;      /**< decoded sensor sample */
+        elect_standby_t standby;    /**< decoded standby announcement */
+        elect_aggregate_t aggregate;    /**< decoded aggregate */
+    } content;
+    bool used;                      /**< buffer is in use */
+} listen_buf_t;
+
+static listen_buf_t listen_bufs[LISTEN_BUF_NUM];
+/* listener waits for a buffer to be released */
+static bool listen_waiting;
+
+static char server_stack[ELECT_LISTEN_STACKSIZE];
 static kernel_pid_t server_pid = KERNEL_PID_UNDEF;
 /* the link local IP address of this node as string */
 static ipv6_addr_t ip_addr;
 static char ip_addr_str[IPV6_ADDR_MAX_STR_LEN];
 static sock_udp_t _sock;
+/* aggregates are received on a port of their own, by a second thread */
+static char aggr_stack[ELECT_AGGR_STACKSIZE];
+static kernel_pid_t aggr_pid = KERNEL_PID_UNDEF;
+static sock_udp_t _aggr_sock;
+/* recent senders of node IDs, owned by the listener */
+static elect_dedup_t listen_dedup;
 
 static kernel_pid_t main_pid;
 
@@ -71,6 +101,142 @@ void _get_ip_addr(ipv6_addr_t *addr)
     ipv6_addr_set_unspecified(addr);
 }
 
+/**
+ * @brief Set link local address from interface ID
+ */
+static void _set_iid(ipv6_addr_t *addr, const uint8_t *iid)
+{
+    memset(addr, 0, sizeof(ipv6_addr_t));
+    ipv6_addr_set_link_local_prefix(addr);
+    memcpy(&addr->u8[ELECT_FRAME_IID_LEN], iid, ELECT_FRAME_IID_LEN);
+}
+
+/**
+ * @brief Parse node ID from a received broadcast
+ *
+ * Accepts binary frames as well as the legacy textual format.
+ *
+ * @param[in]  buf      received data, must hold one spare byte after @p len
+ * @param[in]  len      length of received data
+ * @param[out] addr     parsed IP address
+ *
+ * @returns 0 on success, error otherwise
+ */
+static int _parse_id(uint8_t *buf, size_t len, ipv6_addr_t *addr)
+{
+    if ((len > 0) && (ELECT_FRAME_VER(buf[0]) == ELECT_FRAME_VERSION)) {
+        switch (ELECT_FRAME_TYPE(buf[0])) {
+            case ELECT_FRAME_NODEID:
+                if (len != (1 + sizeof(ipv6_addr_t))) {
+                    return 1;
+                }
+                memcpy(addr, &buf[1], sizeof(ipv6_addr_t));
+                return 0;
+            case ELECT_FRAME_NODEID_IID:
+                if (len != (1 + ELECT_FRAME_IID_LEN)) {
+                    return 1;
+                }
+                _set_iid(addr, &buf[1]);
+                return 0;
+            default:
+                return 1;
+        }
+    }
+    /* fall back to textual format */
+    buf[len] = '\0';
+    return (ipv6_addr_from_str(addr, (char *)buf) == NULL) ? 1 : 0;
+}
+
+/**
+ * @brief Parse standby announcement, `[hdr, epoch (2), leader, standby]`
+ *        with interface IDs, standby is omitted if there is none
+ *
+ * @returns 0 on success, error otherwise
+ */
+static int _parse_standby(const uint8_t *buf, size_t len,
+                          elect_standby_t *standby)
+{
+    if ((len != (3 + ELECT_FRAME_IID_LEN)) &&
+        (len != (3 + 2 * ELECT_FRAME_IID_LEN))) {
+        return 1;
+    }
+    standby->epoch = (uint16_t)((buf[1] << 8) | buf[2]);
+    _set_iid(&standby->leader, &buf[3]);
+    if (len > (3 + ELECT_FRAME_IID_LEN)) {
+        _set_iid(&standby->standby, &buf[3 + ELECT_FRAME_IID_LEN]);
+    }
+    else {
+        ipv6_addr_set_unspecified(&standby->standby);
+    }
+    return 0;
+}
+
+/**
+ * @brief Parse aggregate, `[hdr, epoch (2), value (2), interval (2), leader]`
+ *        with the interval in ms and the interface ID of the leader
+ *
+ * @returns 0 on success, error otherwise
+ */
+static int _parse_aggregate(const uint8_t *buf, size_t len,
+                            elect_aggregate_t *aggr)
+{
+    if ((len != AGGR_FRAME_LEN) ||
+        (ELECT_FRAME_VER(buf[0]) != ELECT_FRAME_VERSION) ||
+        (ELECT_FRAME_TYPE(buf[0]) != ELECT_FRAME_AGGREGATE)) {
+        return 1;
+    }
+    aggr->epoch = (uint16_t)((buf[1] << 8) | buf[2]);
+    aggr->value = (int16_t)((buf[3] << 8) | buf[4]);
+    aggr->interval = (uint16_t)((buf[5] << 8) | buf[6]);
+    _set_iid(&aggr->leader, &buf[7]);
+    return 0;
+}
+
+/**
+ * @brief Get free receive buffer from pool
+ *
+ * @param[in] wait  let the next release wake up the listener, if all
+ *                  buffers are in use
+ *
+ * @returns pointer to buffer, NULL if all are in use
+ */
+static listen_buf_t *_buf_alloc(bool wait)
+{
+    unsigned state = irq_disable();
+    for (unsigned i = 0; i < LISTEN_BUF_NUM; ++i) {
+        if (!listen_bufs[i].used) {
+            listen_bufs[i].used = true;
+            irq_restore(state);
+            return &listen_bufs[i];
+        }
+    }
+    /* only the listener waits, the aggregate thread must not reset it */
+    if (wait) {
+        listen_waiting = true;
+    }
+    irq_restore(state);
+    return NULL;
+}
+
+/**
+ * @brief Hand decoded content of buffer over to main
+ *
+ * @returns 0 on success, 1 if main is busy and the content was dropped
+ */
+static int _buf_pass(uint16_t type, void *content)
+{
+    msg_t m;
+    m.type = type;
+    m.content.ptr = content;
+    if (msg_try_send(&m, main_pid) != 1) {
+        LOG_WARNING("%s: main is busy, dropped!\n", __func__);
+        stats_inc(ELECT_STATS_RX_DROP);
+        listen_release(content);
+        return 1;
+    }
+    return 0;
+}
+
 static void *_listen_loop(void *arg)
 {
     (void)arg;
@@ -80,17 +246,101 @@ static void *_listen_loop(void *arg)
     msg_init_queue(msg_queue, LISTEN_MSG_QUEUE_SIZE);
 
     while (1) {
-        uint8_t buf[IPV6_ADDR_MAX_STR_LEN];
+        listen_buf_t *buf;
+        while ((buf = _buf_alloc(true)) == NULL) {
+            /* all buffers are owned by main, wait for one to be released */
+            msg_t m;
+            msg_receive(&m);
+        }
         sock_udp_ep_t remote;
 
-        ssize_t res = sock_udp_recv(&_sock, buf, sizeof(buf),
+        /* main does not block the listener, so it drains the socket back to
+         * back as long as receive buffers are left */
+        ssize_t res = sock_udp_recv(&_sock, buf->data, sizeof(buf->data) - 1,
                                     SOCK_NO_TIMEOUT, &remote);
-        buf[res] = '\0';
+        if (res <= 0) {
+            LOG_ERROR("%s: receive failed (%d)\n", __func__, (int)res);
+            listen_release(buf);
+            continue;
+        }
         LOG_DEBUG("%s: received %u byte(s)!\n", __func__, (unsigned)res);
-        msg_t m;
-        m.type = ELECT_BROADCAST_EVENT;
-        m.content.ptr = &buf[0];
-        msg_send_receive(&m, &m, main_pid);
+        ELECT_TRACE(ELECT_TRACE_UDP_RX, remote.port, res);
+        if ((remote.port == ELECT_COAP_PORT) ||
+            (ELECT_FRAME_VER(buf->data[0]) != ELECT_FRAME_VERSION)) {
+            /* response to a request sent from this socket, or one a member
+             * sent from its listener after the Leisure of a group request */
+            if (coap_recv_resp(buf->data, (size_t)res, &remote,
+                               &buf->content.sample) == 0) {
+                _buf_pass(ELECT_SENSOR_EVENT, &buf->content.sample);
+            }
+            else {
+                listen_release(buf);
+            }
+            continue;
+        }
+        if ((ELECT_FRAME_VER(buf->data[0]) == ELECT_FRAME_VERSION) &&
+            (ELECT_FRAME_TYPE(buf->data[0]) == ELECT_FRAME_STANDBY)) {
+            if (_parse_standby(buf->data, (size_t)res,
+                               &buf->content.standby) == 0) {
+                _buf_pass(ELECT_STANDBY_EVENT, &buf->content.standby);
+            }
+            else {
+                listen_release(buf);
+            }
+            continue;
+        }
+        if (_parse_id(buf->data, (size_t)res, &buf->content.id) != 0) {
+            LOG_WARNING("%s: invalid node ID, dropped!\n", __func__);
+            listen_release(buf);
+            continue;
+        }
+        stats_inc(ELECT_STATS_BCAST_RX);
+        const uint8_t *sender = &remote.addr.ipv6[ELECT_FRAME_IID_LEN];
+        uint32_t now = (uint32_t)(xtimer_now_usec64() / US_PER_MS);
+        if (dedup_check(&listen_dedup, sender, &buf->content.id, now)) {
+            stats_inc(ELECT_STATS_BCAST_DUP);
+            listen_release(buf);
+            continue;
+        }
+        /* an ID not matching the sender's interface ID is relayed gossip */
+        uint16_t type = (memcmp(&buf->content.id.u8[ELECT_FRAME_IID_LEN],
+                                sender, ELECT_FRAME_IID_LEN) != 0)
+                        ? ELECT_RELAY_EVENT : ELECT_BROADCAST_EVENT;
+        if (_buf_pass(type, &buf->content.id) != 0) {
+            /* let the next repeat through */
+            dedup_forget(&listen_dedup, sender);
+        }
+    }
+    /* never reached */
+    return NULL;
+}
+
+static void *_aggr_loop(void *arg)
+{
+    (void)arg;
+
+    while (1) {
+        uint8_t data[AGGR_FRAME_LEN];
+        sock_udp_ep_t remote;
+
+        ssize_t res = sock_udp_recv(&_aggr_sock, data, sizeof(data),
+                                    SOCK_NO_TIMEOUT, &remote);
+        if (res <= 0) {
+            continue;
+        }
+        ELECT_TRACE(ELECT_TRACE_UDP_RX, remote.port, res);
+        /* a lost aggregate does no harm, drop it instead of waiting */
+        listen_buf_t *buf = _buf_alloc(false);
+        if (buf == NULL) {
+            stats_inc(ELECT_STATS_RX_DROP);
+            continue;
+        }
+        if (_parse_aggregate(data, (size_t)res, &buf->content.aggregate) != 0) {
+            LOG_WARNING("%s: invalid aggregate, dropped!\n", __func__);
+            listen_release(buf);
+            continue;
+        }
+        _buf_pass(ELECT_AGGREGATE_EVENT, &buf->content.aggregate);
     }
     /* never reached */
     return NULL;
@@ -107,6 +357,7 @@ int _udp_send(ipv6_addr_t addr, uint16_t port, const uint8_t *data, size_t dlen)
     memcpy(&remote.addr.ipv6[0], &addr.u8[0], 16);
 
     int res = (int)sock_udp_send(&_sock, data, dlen, &remote);
+    ELECT_TRACE(ELECT_TRACE_UDP_TX, port, res);
     if (res < 0) {
         LOG_ERROR("%s: failed (%d)\n", __func__, res);
     }
@@ -123,6 +374,7 @@ int listen_init(kernel_pid_t main)
     LOG_DEBUG("%s: begin\n", __func__);
     main_pid = main;
     if (server_pid <= KERNEL_PID_UNDEF) {
+        dedup_init(&listen_dedup);
         server_pid = thread_create(server_stack, sizeof(server_stack),
                                    (THREAD_PRIORITY_MAIN - 1),
                                    THREAD_CREATE_STACKTEST,
@@ -132,6 +384,16 @@ int listen_init(kernel_pid_t main)
             return 1;
         }
     }
+    if (aggr_pid <= KERNEL_PID_UNDEF) {
+        aggr_pid = thread_create(aggr_stack, sizeof(aggr_stack),
+                                 (THREAD_PRIORITY_MAIN - 1),
+                                 THREAD_CREATE_STACKTEST,
+                                 _aggr_loop, NULL, "aggr");
+        if (aggr_pid <= KERNEL_PID_UNDEF) {
+            LOG_ERROR("%s: can not start aggregate thread!\n", __func__);
+            return 1;
+        }
+    }
     LOG_DEBUG("%s: done\n", __func__);
     return 0;
 }
@@ -177,6 +439,19 @@ int net_init(kernel_pid_t main)
         LOG_ERROR("%s: cannot create listen sock!\n", __func__);
         return 1;
     }
+
+    /* receive aggregates of the coordinator as sign of life */
+    ipv6_addr_t group = ELECT_BC_SENSOR_ADDR;
+    ret = gnrc_netapi_set(iface, NETOPT_IPV6_GROUP, 0, &group, sizeof(group));
+    if (ret < 0) {
+        LOG_ERROR("%s: failed joining aggregate group (%i)\n", __func__, ret);
+        return 1;
+    }
+    local.port = ELECT_BC_SENSOR_PORT;
+    if (sock_udp_create(&_aggr_sock, &local, NULL, 0) < 0) {
+        LOG_ERROR("%s: cannot create aggregate sock!\n", __func__);
+        return 1;
+    }
     LOG_DEBUG("%s: done\n", __func__);
     return 0;
 }
@@ -191,25 +466,95 @@ int ipv6_addr_cmp(const ipv6_addr_t *ip1, const ipv6_addr_t *ip2)
     return memcmp(ip1, ip2, sizeof(ipv6_addr_t));
 }
 
+int listen_release(void *ptr)
+{
+    uintptr_t pos = (uintptr_t)ptr;
+    uintptr_t start = (uintptr_t)&listen_bufs[0];
+    if ((pos < start) || (pos >= (uintptr_t)&listen_bufs[LISTEN_BUF_NUM])) {
+        return 1;
+    }
+    listen_buf_t *buf = &listen_bufs[(pos - start) / sizeof(listen_buf_t)];
+    unsigned state = irq_disable();
+    buf->used = false;
+    bool wakeup = listen_waiting;
+    listen_waiting = false;
+    irq_restore(state);
+    if (wakeup) {
+        msg_t m = { .type = LISTEN_BUF_FREE_EVENT };
+        msg_try_send(&m, server_pid);
+    }
+    return 0;
+}
+
+void listen_dedup_window(uint32_t ms)
+{
+    /* a single word, read by the listener as is */
+    listen_dedup.window = ms;
+}
+
+int listen_send(const ipv6_addr_t *addr, uint16_t port,
+                const uint8_t *data, size_t len)
+{
+    return _udp_send(*addr, port, data, len);
+}
+
 int broadcast_id(const ipv6_addr_t *ip)
 {
     LOG_DEBUG("%s: begin.\n", __func__);
     ipv6_addr_t bcast_addr = ELECT_BC_NODEID_ADDR;
-    char ip_str[IPV6_ADDR_MAX_STR_LEN];
-    if (ipv6_addr_to_str(ip_str, ip, sizeof(ip_str)) == NULL) {
-        LOG_ERROR("%s: failed to convert IP address!\n", __func__);
-        return 1;
+    uint8_t frame[1 + sizeof(ipv6_addr_t)];
+    size_t len;
+    if (ipv6_addr_is_link_local(ip)) {
+        frame[0] = ELECT_FRAME_HDR(ELECT_FRAME_NODEID_IID);
+        memcpy(&frame[1], &ip->u8[ELECT_FRAME_IID_LEN], ELECT_FRAME_IID_LEN);
+        len = 1 + ELECT_FRAME_IID_LEN;
+    }
+    else {
+        frame[0] = ELECT_FRAME_HDR(ELECT_FRAME_NODEID);
+        memcpy(&frame[1], ip, sizeof(ipv6_addr_t));
+        len = 1 + sizeof(ipv6_addr_t);
     }
-    return _udp_send(bcast_addr, ELECT_BC_NODEID_PORT,
-                     (uint8_t *)ip_str, strlen(ip_str));
+    stats_inc(ELECT_STATS_BCAST_TX);
+    return _udp_send(bcast_addr, ELECT_BC_NODEID_PORT, frame, len);
 }
 
-int broadcast_sensor(int16_t val)
+int broadcast_standby(uint16_t epoch, const ipv6_addr_t *leader,
+                      const ipv6_addr_t *standby)
 {
-    LOG_DEBUG("%s: begin (val=%"PRIi16").\n", __func__, val);
+    LOG_DEBUG("%s: begin (epoch=%u).\n", __func__, (unsigned)epoch);
+    ipv6_addr_t bcast_addr = ELECT_BC_NODEID_ADDR;
+    uint8_t frame[3 + 2 * ELECT_FRAME_IID_LEN];
+    size_t len = 3 + ELECT_FRAME_IID_LEN;
+    frame[0] = ELECT_FRAME_HDR(ELECT_FRAME_STANDBY);
+    frame[1] = (uint8_t)(epoch >> 8);
+    frame[2] = (uint8_t)epoch;
+    memcpy(&frame[3], &leader->u8[ELECT_FRAME_IID_LEN], ELECT_FRAME_IID_LEN);
+    if (!ipv6_addr_is_unspecified(standby)) {
+        memcpy(&frame[len], &standby->u8[ELECT_FRAME_IID_LEN],
+               ELECT_FRAME_IID_LEN);
+        len += ELECT_FRAME_IID_LEN;
+    }
+    stats_inc(ELECT_STATS_STANDBY_TX);
+    return _udp_send(bcast_addr, ELECT_BC_NODEID_PORT, frame, len);
+}
+
+int broadcast_sensor(uint16_t epoch, const ipv6_addr_t *leader, int16_t value,
+                     uint32_t interval)
+{
+    LOG_DEBUG("%s: begin (val=%"PRIi16").\n", __func__, value);
     ipv6_addr_t bcast_addr = ELECT_BC_SENSOR_ADDR;
-    char val_str[ELECT_BC_SENSOR_LEN];
-    size_t len = fmt_s16_dec(val_str, val);
-    return _udp_send(bcast_addr, ELECT_BC_SENSOR_PORT,
-                     (uint8_t *)val_str, len);
+    uint8_t frame[AGGR_FRAME_LEN];
+    frame[0] = ELECT_FRAME_HDR(ELECT_FRAME_AGGREGATE);
+    frame[1] = (uint8_t)(epoch >> 8);
+    frame[2] = (uint8_t)epoch;
+    frame[3] = (uint8_t)((uint16_t)value >> 8);
+    frame[4] = (uint8_t)value;
+    if (interval > UINT16_MAX) {
+        interval = UINT16_MAX;
+    }
+    frame[5] = (uint8_t)(interval >> 8);
+    frame[6] = (uint8_t)interval;
+    memcpy(&frame[7], &leader->u8[ELECT_FRAME_IID_LEN], ELECT_FRAME_IID_LEN);
+    stats_inc(ELECT_STATS_AGGR_TX);
+    return _udp_send(bcast_addr, ELECT_BC_SENSOR_PORT, frame, sizeof(frame));
 }